@@ -0,0 +1,121 @@
+#include <iostream>
+#include <string>
+#include <ctime>
+#include <chrono>
+#include "../src/Int.hpp"
+#include "../src/BinOps.hpp"
+#include "../src/Parallel.hpp"
+
+using namespace std;
+
+/* mul_bench - time Int multiplication at various sizes and thresholds
+ *   Use this to pick the thresholds in src/Multiply.cpp for a given machine:
+ *   the best threshold is the smallest one at which the faster algorithm wins.
+ *   The last table shows how products scale with PARALLEL_THREADS.
+ */
+
+/* make a number with about num_digits random digits (deterministic) */
+Int random_int(size_t num_digits, unsigned seed) {
+    string s(num_digits, '0');
+    s[0] = '1' + seed % 9;
+    for (size_t i = 1; i < num_digits; ++i) {
+        seed = seed * 1103515245 + 12345;
+        s[i] = '0' + (seed >> 16) % 10;
+    }
+    return Int(s);
+}
+
+/* seconds per product of x and y */
+double time_product(const Int& x, const Int& y) {
+    int reps = 0;
+    clock_t start = clock();
+    clock_t elapsed;
+    do {
+        Int p = x * y;
+        ++reps;
+        elapsed = clock() - start;
+    } while (elapsed < CLOCKS_PER_SEC / 10);
+    return ((double) elapsed / CLOCKS_PER_SEC) / reps;
+}
+
+/* wall-clock seconds per product of x and y (clock() would add up every thread's time) */
+double wall_time_product(const Int& x, const Int& y) {
+    typedef std::chrono::steady_clock clk;
+    int reps = 0;
+    clk::time_point start = clk::now();
+    double elapsed;
+    do {
+        Int p = x * y;
+        ++reps;
+        elapsed = std::chrono::duration<double>(clk::now() - start).count();
+    } while (elapsed < 0.1);
+    return elapsed / reps;
+}
+
+/* print a table of microseconds per product: one row per size, one column per
+ * value of threshold (1000000 meaning the algorithm is never used) */
+void sweep(const char* name, size_t& threshold, const size_t* values, size_t num_values,
+           const size_t* digits, size_t num_sizes) {
+    size_t saved = threshold;
+    cout << name << " threshold (bins) vs. microseconds per product" << endl;
+    cout << "digits";
+    for (size_t t = 0; t < num_values; ++t) {
+        if (values[t] == 1000000)
+            cout << "\tnever";
+        else
+            cout << "\t" << values[t];
+    }
+    cout << endl;
+    for (size_t d = 0; d < num_sizes; ++d) {
+        Int x = random_int(digits[d], d + 1);
+        Int y = random_int(digits[d], d + 100);
+        cout << digits[d];
+        for (size_t t = 0; t < num_values; ++t) {
+            threshold = values[t];
+            cout << "\t" << (long) (time_product(x, y) * 1e6);
+        }
+        cout << endl;
+    }
+    cout << endl;
+    threshold = saved;
+}
+
+int main() {
+    const size_t karatsuba[] = { 8, 16, 24, 32, 48, 64, 1000000 };
+    const size_t karatsuba_digits[] = { 100, 200, 400, 800, 1600, 3200, 6400 };
+    sweep("Karatsuba", KARATSUBA_THRESHOLD, karatsuba, 7, karatsuba_digits, 7);
+
+    const size_t toom3[] = { 100, 150, 200, 300, 400, 1000000 };
+    const size_t toom3_digits[] = { 2000, 4000, 8000, 16000, 32000 };
+    size_t saved_toom4 = TOOM4_THRESHOLD;
+    TOOM4_THRESHOLD = 1000000;
+    sweep("Toom-3", TOOM3_THRESHOLD, toom3, 6, toom3_digits, 5);
+    TOOM4_THRESHOLD = saved_toom4;
+
+    const size_t toom4[] = { 300, 400, 600, 800, 1200, 1000000 };
+    const size_t toom4_digits[] = { 8000, 16000, 32000, 64000, 128000 };
+    sweep("Toom-4", TOOM4_THRESHOLD, toom4, 6, toom4_digits, 5);
+
+    const size_t ntt[] = { 1000, 2000, 3000, 5000, 10000, 1000000 };
+    const size_t ntt_digits[] = { 32000, 64000, 128000, 256000, 1000000 };
+    sweep("NTT", NTT_THRESHOLD, ntt, 6, ntt_digits, 5);
+
+    const size_t threads[] = { 1, 2, 4, 8, 16 };
+    const size_t thread_digits[] = { 20000, 100000, 1000000, 5000000 };
+    size_t saved_threads = PARALLEL_THREADS;
+    cout << "PARALLEL_THREADS vs. wall-clock microseconds per product" << endl << "digits";
+    for (size_t t = 0; t < 5; ++t)
+        cout << "\t" << threads[t];
+    cout << endl;
+    for (size_t d = 0; d < 4; ++d) {
+        Int x = random_int(thread_digits[d], d + 1);
+        Int y = random_int(thread_digits[d], d + 100);
+        cout << thread_digits[d];
+        for (size_t t = 0; t < 5; ++t) {
+            PARALLEL_THREADS = threads[t];
+            cout << "\t" << (long) (wall_time_product(x, y) * 1e6);
+        }
+        cout << endl;
+    }
+    PARALLEL_THREADS = saved_threads;
+}
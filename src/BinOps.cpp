@@ -0,0 +1,181 @@
+#include <cstring>
+#include "BinOps.hpp"
+
+bin_t bins_add(bin_t* r, const bin_t* a, size_t an, const bin_t* b, size_t bn) {
+    bin_t carry = bins_add_n(r, a, b, bn, 0);
+    return bins_add_1(r + bn, a + bn, an - bn, carry);
+}
+
+bin_t bins_add_1(bin_t* r, const bin_t* a, size_t n, bin_t c) {
+    size_t i = 0;
+    for (; c != 0 && i < n; ++i) {
+        r[i] = a[i] + c;
+        c = (r[i] < c) ? 1 : 0;
+    }
+    if (r != a)
+        for (; i < n; ++i)
+            r[i] = a[i];
+    return c;
+}
+
+bin_t bins_sub(bin_t* r, const bin_t* a, size_t an, const bin_t* b, size_t bn) {
+    bin_t borrow = bins_sub_n(r, a, b, bn, 0);
+    return bins_sub_1(r + bn, a + bn, an - bn, borrow);
+}
+
+bin_t bins_sub_1(bin_t* r, const bin_t* a, size_t n, bin_t c) {
+    size_t i = 0;
+    bin_t x;
+    for (; c != 0 && i < n; ++i) {
+        x = a[i];
+        r[i] = x - c;
+        c = (x < c) ? 1 : 0;
+    }
+    if (r != a)
+        for (; i < n; ++i)
+            r[i] = a[i];
+    return c;
+}
+
+void bins_neg(bin_t* r, const bin_t* a, size_t n) {
+    size_t i = 0;
+    for (; i < n && a[i] == 0; ++i)
+        r[i] = 0;
+    if (i < n) {
+        r[i] = -a[i];
+        for (++i; i < n; ++i)
+            r[i] = ~a[i];
+    }
+}
+
+bin_t bins_mul_1(bin_t* r, const bin_t* a, size_t n, bin_t y) {
+    uint64_t carry = 0;
+    for (size_t i = 0; i < n; ++i) {
+        carry += (uint64_t) a[i] * y;
+        r[i] = (bin_t) carry;
+        carry >>= BINOPS_BITS;
+    }
+    return (bin_t) carry;
+}
+
+bin_t bins_addmul_1(bin_t* r, const bin_t* a, size_t n, bin_t y) {
+    uint64_t carry = 0;
+    for (size_t i = 0; i < n; ++i) {
+        carry += (uint64_t) a[i] * y + r[i];  // at most (2^32-1)^2 + 2(2^32-1) < 2^64
+        r[i] = (bin_t) carry;
+        carry >>= BINOPS_BITS;
+    }
+    return (bin_t) carry;
+}
+
+bin_t bins_submul_1(bin_t* r, const bin_t* a, size_t n, bin_t y) {
+    uint64_t prod;
+    bin_t borrow = 0, lo;
+    for (size_t i = 0; i < n; ++i) {
+        prod = (uint64_t) a[i] * y + borrow;
+        lo = (bin_t) prod;
+        borrow = (bin_t) (prod >> BINOPS_BITS) + ((r[i] < lo) ? 1 : 0);
+        r[i] -= lo;
+    }
+    return borrow;
+}
+
+bin_t bins_divrem_1(bin_t* q, const bin_t* a, size_t n, bin_t y) {
+    uint64_t d, r = 0;
+    while (n-- > 0) {
+        d = (r << BINOPS_BITS) | a[n];
+        q[n] = (bin_t) (d / y);
+        r = d % y;
+    }
+    return (bin_t) r;
+}
+
+bin_t bins_mod_1(const bin_t* a, size_t n, bin_t y) {
+    uint64_t r = 0;
+    while (n-- > 0)
+        r = ((r << BINOPS_BITS) | a[n]) % y;
+    return (bin_t) r;
+}
+
+/* bins_divexact_1 - exact division by a single bin
+ *   Since y divides a, the quotient can be found from the bottom up by multiplying
+ *   by the inverse of y modulo 2^32 instead of dividing (Jebelean's exact division).
+ *   Factors of two are shifted out first, since only odd numbers have an inverse.
+ */
+void bins_divexact_1(bin_t* q, const bin_t* a, size_t n, bin_t y) {
+    uint32_t shift = 0;
+    while ((y & 1) == 0) {
+        y >>= 1;
+        ++shift;
+    }
+    if (shift > 0) {
+        bins_rshift(q, a, n, shift);
+        a = q;
+    }
+    if (y == 1) {
+        if (q != a)
+            memmove(q, a, n * sizeof(bin_t));
+        return;
+    }
+    bin_t inv = y;              // Newton's iteration: each step doubles the correct low bits
+    for (int i = 0; i < 4; ++i)
+        inv *= 2 - y * inv;
+    bin_t borrow = 0, s, b;
+    for (size_t i = 0; i < n; ++i) {
+        s = a[i] - borrow;
+        b = (a[i] < borrow) ? 1 : 0;
+        q[i] = s * inv;
+        borrow = (bin_t) (((uint64_t) q[i] * y) >> BINOPS_BITS) + b;
+    }
+}
+
+bin_t bins_rshift(bin_t* r, const bin_t* a, size_t n, uint32_t shift) {
+    bin_t out = a[0] << (BINOPS_BITS - shift);
+    for (size_t i = 0; i + 1 < n; ++i)
+        r[i] = (a[i] >> shift) | (a[i + 1] << (BINOPS_BITS - shift));
+    r[n - 1] = a[n - 1] >> shift;
+    return out;
+}
+
+bin_t bins_lshift(bin_t* r, const bin_t* a, size_t n, uint32_t shift) {
+    bin_t out = a[n - 1] >> (BINOPS_BITS - shift);
+    for (size_t i = n - 1; i > 0; --i)
+        r[i] = (a[i] << shift) | (a[i - 1] >> (BINOPS_BITS - shift));
+    r[0] = a[0] << shift;
+    return out;
+}
+
+/* bins_mul_basecase - schoolbook multiplication
+ *   Each row adds a * b[j] into r, starting at bin j, and the row's carry
+ *   lands in the next unused bin of r, so nothing is allocated.
+ */
+void bins_mul_basecase(bin_t* r, const bin_t* a, size_t an, const bin_t* b, size_t bn) {
+    r[an] = bins_mul_1(r, a, an, b[0]);
+    for (size_t j = 1; j < bn; ++j)
+        r[an + j] = bins_addmul_1(r + j, a, an, b[j]);
+}
+
+/* bins_sqr_basecase - schoolbook squaring
+ *   Each cross product a[i] * a[j] (i < j) appears twice in the square, so they
+ *   are summed once, doubled with a shift, and then the squares a[i]^2 on the
+ *   diagonal are added. That is n(n - 1)/2 + n bin products instead of n^2.
+ */
+void bins_sqr_basecase(bin_t* r, const bin_t* a, size_t n) {
+    r[0] = 0;
+    r[n] = bins_mul_1(r + 1, a + 1, n - 1, a[0]);
+    for (size_t i = 1; i + 1 < n; ++i)
+        r[n + i] = bins_addmul_1(r + 2 * i + 1, a + i + 1, n - 1 - i, a[i]);
+    r[2 * n - 1] = 0;
+    bins_lshift(r, r, 2 * n, 1);
+
+    uint64_t carry = 0, sq;
+    for (size_t i = 0; i < n; ++i) {
+        sq = (uint64_t) a[i] * a[i];
+        carry += (uint64_t) r[2 * i] + (bin_t) sq;
+        r[2 * i] = (bin_t) carry;
+        carry >>= BINOPS_BITS;
+        carry += (uint64_t) r[2 * i + 1] + (sq >> BINOPS_BITS);
+        r[2 * i + 1] = (bin_t) carry;
+        carry >>= BINOPS_BITS;
+    }
+}
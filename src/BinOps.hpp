@@ -0,0 +1,85 @@
+#ifndef _BIN_OPS_HPP_
+#define _BIN_OPS_HPP_
+#include "common.hpp"
+
+/* BinOps - arithmetic on raw arrays of bins
+ *   These are the loops underneath Int. Each operates on unsigned base-2^32
+ *   digits stored least-significant first, and knows nothing about signs.
+ *   Unless noted, r may be the same array as a (but must not partially overlap).
+ */
+typedef uint32_t bin_t;
+static const int32_t BINOPS_BITS = 32;
+
+/* the number of zero bits above the top one bit of x, for x != 0 */
+static inline uint32_t leading_zeros(bin_t x) {
+    uint32_t n = 0;
+    for (bin_t bit = (bin_t) 1 << (BINOPS_BITS - 1); (x & bit) == 0; bit >>= 1)
+        ++n;
+    return n;
+}
+
+/* r[0..n) = a[0..n) + b[0..n) + carry, for a carry of 0 or 1; returns the carry out
+ * (this and bins_sub_n and bins_cmp are vectorized where the CPU allows; see BinOpsSimd.cpp) */
+bin_t bins_add_n(bin_t* r, const bin_t* a, const bin_t* b, size_t n, bin_t carry);
+/* r[0..n) = a[0..n) - b[0..n) - borrow, for a borrow of 0 or 1; returns the borrow out */
+bin_t bins_sub_n(bin_t* r, const bin_t* a, const bin_t* b, size_t n, bin_t borrow);
+/* r[0..an) = a[0..an) + b[0..bn), requires an >= bn; returns the carry out */
+bin_t bins_add(bin_t* r, const bin_t* a, size_t an, const bin_t* b, size_t bn);
+/* r[0..n) = a[0..n) + c; returns the carry out */
+bin_t bins_add_1(bin_t* r, const bin_t* a, size_t n, bin_t c);
+/* r[0..an) = a[0..an) - b[0..bn), requires an >= bn; returns the borrow out (r may also be b) */
+bin_t bins_sub(bin_t* r, const bin_t* a, size_t an, const bin_t* b, size_t bn);
+/* r[0..n) = a[0..n) - c; returns the borrow out */
+bin_t bins_sub_1(bin_t* r, const bin_t* a, size_t n, bin_t c);
+/* r[0..n) = -a[0..n) modulo 2^(32n), the two's complement of a */
+void bins_neg(bin_t* r, const bin_t* a, size_t n);
+/* compare a[0..n) with b[0..n); returns -1, 0 or 1 */
+int32_t bins_cmp(const bin_t* a, const bin_t* b, size_t n);
+
+/* r[0..n) = a[0..n) * y; returns the high bin */
+bin_t bins_mul_1(bin_t* r, const bin_t* a, size_t n, bin_t y);
+/* r[0..n) += a[0..n) * y; returns the high bin (r must not overlap a) */
+bin_t bins_addmul_1(bin_t* r, const bin_t* a, size_t n, bin_t y);
+/* r[0..n) -= a[0..n) * y; returns the high bin borrowed (r must not overlap a) */
+bin_t bins_submul_1(bin_t* r, const bin_t* a, size_t n, bin_t y);
+/* q[0..n) = a[0..n) / y; returns the remainder (y must not be zero) */
+bin_t bins_divrem_1(bin_t* q, const bin_t* a, size_t n, bin_t y);
+/* a[0..n) mod y, without the quotient (y must not be zero) */
+bin_t bins_mod_1(const bin_t* a, size_t n, bin_t y);
+/* q[0..n) = a[0..n) / y, where y is known to divide a exactly (y must not be zero) */
+void bins_divexact_1(bin_t* q, const bin_t* a, size_t n, bin_t y);
+/* r[0..n) = a[0..n) >> shift, for 0 < shift < 32; returns the bits shifted out (in the high end) */
+bin_t bins_rshift(bin_t* r, const bin_t* a, size_t n, uint32_t shift);
+/* r[0..n) = a[0..n) << shift, for 0 < shift < 32; returns the bits shifted out (in the low end) */
+bin_t bins_lshift(bin_t* r, const bin_t* a, size_t n, uint32_t shift);
+
+/* Multiplication. For all of these r must not overlap a or b, and has an + bn bins unless rn is given. */
+
+/* schoolbook multiplication; does not allocate */
+void bins_mul_basecase(bin_t* r, const bin_t* a, size_t an, const bin_t* b, size_t bn);
+/* r[0..2n) = a[0..n)^2 by schoolbook squaring; does not allocate */
+void bins_sqr_basecase(bin_t* r, const bin_t* a, size_t n);
+/* picks the fastest algorithm for the operand sizes, and squares when a == b and an == bn (see Multiply.cpp) */
+void bins_mul(bin_t* r, const bin_t* a, size_t an, const bin_t* b, size_t bn);
+/* r[0..rn) += a * b, requires rn >= an + bn; returns the carry out */
+bin_t bins_addmul(bin_t* r, size_t rn, const bin_t* a, size_t an, const bin_t* b, size_t bn);
+/* r[0..rn) -= a * b, requires rn >= an + bn; returns the borrow out */
+bin_t bins_submul(bin_t* r, size_t rn, const bin_t* a, size_t an, const bin_t* b, size_t bn);
+
+/* Division (see Divide.cpp). Requires an >= bn and b[bn - 1] != 0.
+ *   q gets the an - bn + 1 bin quotient and r the bn bin remainder; either may be NULL.
+ *   Neither may overlap a or b. */
+void bins_divrem(bin_t* q, bin_t* r, const bin_t* a, size_t an, const bin_t* b, size_t bn);
+
+/* Operand sizes (in bins of the smaller operand) at which each algorithm takes over. Tunable. */
+extern size_t KARATSUBA_THRESHOLD;
+extern size_t TOOM3_THRESHOLD;
+extern size_t TOOM4_THRESHOLD;
+extern size_t NTT_THRESHOLD;
+/* Smaller operand size (in bins) from which a product is spread over threads, when
+ * PARALLEL_THREADS allows more than one (see Parallel.hpp and Multiply.cpp). */
+extern size_t MUL_PARALLEL_THRESHOLD;
+/* Divisor size (in bins) at which bins_divrem switches from schoolbook to recursive division. */
+extern size_t DIV_DC_THRESHOLD;
+
+#endif
@@ -0,0 +1,221 @@
+#include "BinOps.hpp"
+
+/* BinOpsSimd.cpp - vectorized add, subtract and compare on raw bins
+ *
+ * Adding bins is mostly independent work per bin: only the carries chain. So a block
+ * of bins is added lane by lane, and two masks are taken from the lane sums: g, the
+ * lanes that carried out, and p, the lanes that are all ones (they pass a carry on).
+ * The carry into lane i is then bit i of ((g << 1 | carry_in) + p) ^ p: the add
+ * ripples each carry through a run of ones in p, in one scalar instruction. A lane
+ * can't both carry out and be all ones, which keeps this exact. Subtraction is the
+ * same with borrows, where p is the lanes that are zero.
+ *
+ * Comparison looks for the highest unequal lane from the top, a block at a time.
+ *
+ * On x86-64, the AVX2 kernels (8 bins a block) are picked at run time when the CPU
+ * has them, and the SSE2 ones (4 bins a block, always there on x86-64) otherwise.
+ * Anything else gets the plain loops, which are also used for the tails.
+ */
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(_M_X64))
+#define BINOPS_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+static bin_t add_n_plain(bin_t* r, const bin_t* a, const bin_t* b, size_t n, bin_t carry) {
+    uint64_t c = carry;
+    for (size_t i = 0; i < n; ++i) {
+        c += (uint64_t) a[i] + b[i];
+        r[i] = (bin_t) c;
+        c >>= BINOPS_BITS;
+    }
+    return (bin_t) c;
+}
+
+static bin_t sub_n_plain(bin_t* r, const bin_t* a, const bin_t* b, size_t n, bin_t borrow) {
+    uint64_t diff;
+    for (size_t i = 0; i < n; ++i) {
+        diff = (uint64_t) a[i] - b[i] - borrow;
+        r[i] = (bin_t) diff;
+        borrow = (bin_t) (diff >> 63);  // the difference wrapped around iff it went negative
+    }
+    return borrow;
+}
+
+static int32_t cmp_plain(const bin_t* a, const bin_t* b, size_t n) {
+    while (n-- > 0)
+        if (a[n] != b[n])
+            return (a[n] < b[n]) ? -1 : 1;
+    return 0;
+}
+
+#ifdef BINOPS_X86_SIMD
+
+/* the carries into each lane of a block, from the carry-out and all-ones masks */
+static inline uint32_t lane_carries(uint32_t g, uint32_t p, bin_t& carry, uint32_t lanes) {
+    uint32_t t = p + ((g << 1) | carry);
+    carry = t >> lanes;
+    return (t ^ p) & ((1u << lanes) - 1);
+}
+
+__attribute__((target("avx2")))
+static bin_t add_n_avx2(bin_t* r, const bin_t* a, const bin_t* b, size_t n, bin_t carry) {
+    const __m256i bias = _mm256_set1_epi32((int) 0x80000000);
+    const __m256i ones = _mm256_set1_epi32(-1);
+    const __m256i bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i va = _mm256_loadu_si256((const __m256i*) (a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i*) (b + i));
+        __m256i s = _mm256_add_epi32(va, vb);
+        // unsigned s < a, by comparing with the top bits flipped
+        __m256i gv = _mm256_cmpgt_epi32(_mm256_xor_si256(va, bias), _mm256_xor_si256(s, bias));
+        __m256i pv = _mm256_cmpeq_epi32(s, ones);
+        uint32_t c = lane_carries(_mm256_movemask_ps(_mm256_castsi256_ps(gv)),
+                                  _mm256_movemask_ps(_mm256_castsi256_ps(pv)), carry, 8);
+        __m256i cv = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(c), bits), bits);
+        _mm256_storeu_si256((__m256i*) (r + i), _mm256_sub_epi32(s, cv));  // cv lanes are -1
+    }
+    return add_n_plain(r + i, a + i, b + i, n - i, carry);
+}
+
+__attribute__((target("avx2")))
+static bin_t sub_n_avx2(bin_t* r, const bin_t* a, const bin_t* b, size_t n, bin_t borrow) {
+    const __m256i bias = _mm256_set1_epi32((int) 0x80000000);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i va = _mm256_loadu_si256((const __m256i*) (a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i*) (b + i));
+        __m256i d = _mm256_sub_epi32(va, vb);
+        __m256i gv = _mm256_cmpgt_epi32(_mm256_xor_si256(vb, bias), _mm256_xor_si256(va, bias));
+        __m256i pv = _mm256_cmpeq_epi32(d, zero);
+        uint32_t c = lane_carries(_mm256_movemask_ps(_mm256_castsi256_ps(gv)),
+                                  _mm256_movemask_ps(_mm256_castsi256_ps(pv)), borrow, 8);
+        __m256i cv = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(c), bits), bits);
+        _mm256_storeu_si256((__m256i*) (r + i), _mm256_add_epi32(d, cv));
+    }
+    return sub_n_plain(r + i, a + i, b + i, n - i, borrow);
+}
+
+__attribute__((target("avx2")))
+static int32_t cmp_avx2(const bin_t* a, const bin_t* b, size_t n) {
+    for (; n >= 8; n -= 8) {
+        __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*) (a + n - 8)),
+                                        _mm256_loadu_si256((const __m256i*) (b + n - 8)));
+        uint32_t diff = ~_mm256_movemask_ps(_mm256_castsi256_ps(eq)) & 0xFF;
+        if (diff != 0) {
+            size_t i = n - 8 + (31 - __builtin_clz(diff));
+            return (a[i] < b[i]) ? -1 : 1;
+        }
+    }
+    return cmp_plain(a, b, n);
+}
+
+static bin_t add_n_sse2(bin_t* r, const bin_t* a, const bin_t* b, size_t n, bin_t carry) {
+    const __m128i bias = _mm_set1_epi32((int) 0x80000000);
+    const __m128i ones = _mm_set1_epi32(-1);
+    const __m128i bits = _mm_setr_epi32(1, 2, 4, 8);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i va = _mm_loadu_si128((const __m128i*) (a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*) (b + i));
+        __m128i s = _mm_add_epi32(va, vb);
+        __m128i gv = _mm_cmpgt_epi32(_mm_xor_si128(va, bias), _mm_xor_si128(s, bias));
+        __m128i pv = _mm_cmpeq_epi32(s, ones);
+        uint32_t c = lane_carries(_mm_movemask_ps(_mm_castsi128_ps(gv)),
+                                  _mm_movemask_ps(_mm_castsi128_ps(pv)), carry, 4);
+        __m128i cv = _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(c), bits), bits);
+        _mm_storeu_si128((__m128i*) (r + i), _mm_sub_epi32(s, cv));
+    }
+    return add_n_plain(r + i, a + i, b + i, n - i, carry);
+}
+
+static bin_t sub_n_sse2(bin_t* r, const bin_t* a, const bin_t* b, size_t n, bin_t borrow) {
+    const __m128i bias = _mm_set1_epi32((int) 0x80000000);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bits = _mm_setr_epi32(1, 2, 4, 8);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i va = _mm_loadu_si128((const __m128i*) (a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*) (b + i));
+        __m128i d = _mm_sub_epi32(va, vb);
+        __m128i gv = _mm_cmpgt_epi32(_mm_xor_si128(vb, bias), _mm_xor_si128(va, bias));
+        __m128i pv = _mm_cmpeq_epi32(d, zero);
+        uint32_t c = lane_carries(_mm_movemask_ps(_mm_castsi128_ps(gv)),
+                                  _mm_movemask_ps(_mm_castsi128_ps(pv)), borrow, 4);
+        __m128i cv = _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(c), bits), bits);
+        _mm_storeu_si128((__m128i*) (r + i), _mm_add_epi32(d, cv));
+    }
+    return sub_n_plain(r + i, a + i, b + i, n - i, borrow);
+}
+
+static int32_t cmp_sse2(const bin_t* a, const bin_t* b, size_t n) {
+    for (; n >= 4; n -= 4) {
+        __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*) (a + n - 4)),
+                                     _mm_loadu_si128((const __m128i*) (b + n - 4)));
+        uint32_t diff = ~_mm_movemask_ps(_mm_castsi128_ps(eq)) & 0xF;
+        if (diff != 0) {
+            size_t i = n - 4 + (31 - __builtin_clz(diff));
+            return (a[i] < b[i]) ? -1 : 1;
+        }
+    }
+    return cmp_plain(a, b, n);
+}
+
+/* The kernels for this CPU, picked the first time one is needed */
+struct SimdKernels {
+    bin_t (*add_n)(bin_t*, const bin_t*, const bin_t*, size_t, bin_t);
+    bin_t (*sub_n)(bin_t*, const bin_t*, const bin_t*, size_t, bin_t);
+    int32_t (*cmp)(const bin_t*, const bin_t*, size_t);
+
+    SimdKernels() {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            add_n = add_n_avx2;
+            sub_n = sub_n_avx2;
+            cmp = cmp_avx2;
+        } else {
+            add_n = add_n_sse2;
+            sub_n = sub_n_sse2;
+            cmp = cmp_sse2;
+        }
+    }
+};
+
+static inline const SimdKernels& kernels() {
+    static const SimdKernels k;     // a function-local static, so it's ready for other static initializers
+    return k;
+}
+
+/* Blocks only pay off from a few of them; Ints this short take the plain loops */
+static const size_t SIMD_MIN_BINS = 16;
+
+bin_t bins_add_n(bin_t* r, const bin_t* a, const bin_t* b, size_t n, bin_t carry) {
+    return (n < SIMD_MIN_BINS) ? add_n_plain(r, a, b, n, carry) : kernels().add_n(r, a, b, n, carry);
+}
+
+bin_t bins_sub_n(bin_t* r, const bin_t* a, const bin_t* b, size_t n, bin_t borrow) {
+    return (n < SIMD_MIN_BINS) ? sub_n_plain(r, a, b, n, borrow) : kernels().sub_n(r, a, b, n, borrow);
+}
+
+int32_t bins_cmp(const bin_t* a, const bin_t* b, size_t n) {
+    return (n < SIMD_MIN_BINS) ? cmp_plain(a, b, n) : kernels().cmp(a, b, n);
+}
+
+#else
+
+bin_t bins_add_n(bin_t* r, const bin_t* a, const bin_t* b, size_t n, bin_t carry) {
+    return add_n_plain(r, a, b, n, carry);
+}
+
+bin_t bins_sub_n(bin_t* r, const bin_t* a, const bin_t* b, size_t n, bin_t borrow) {
+    return sub_n_plain(r, a, b, n, borrow);
+}
+
+int32_t bins_cmp(const bin_t* a, const bin_t* b, size_t n) {
+    return cmp_plain(a, b, n);
+}
+
+#endif
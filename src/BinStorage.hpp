@@ -0,0 +1,350 @@
+#ifndef _BIN_STORAGE_HPP_
+#define _BIN_STORAGE_HPP_
+#include <cstring>
+#include <stdexcept>
+#include "common.hpp"
+
+/* BinPoolStats - where a thread's heap bin arrays came from */
+struct BinPoolStats {
+    size_t pooled;      /* taken from the thread's pool */
+    size_t heap;        /* new'd, because the pool had none of the size */
+    size_t cached;      /* bytes the pool holds right now */
+};
+
+/* BinPool - a per-thread cache of freed heap arrays of bins
+ *   Heap arrays come in power-of-two sizes. A released array goes on its thread's
+ *   free list for its size instead of back to the allocator, and the next allocation
+ *   of that size takes it back off. A pool keeps up to MAX_CACHED arrays of each size
+ *   and MAX_CACHED_BYTES in all, and no arrays above 2^(BUCKETS - 1) bins, so a
+ *   thread doesn't hold on to the memory of one huge computation after it. So a loop
+ *   that keeps making and dropping temporaries of about the same size soon stops
+ *   calling new and delete at all. An array may be released by another thread than
+ *   the one that allocated it; it just joins that thread's pool.
+ *
+ *   The pool has no locks, since each thread has its own. A thread's cached arrays
+ *   are freed when it exits.
+ */
+template <typename T>
+class BinPool {
+  public:
+    static const size_t BUCKETS = 21;                   /* sizes up to 2^20 bins are cached */
+    static const size_t MAX_CACHED = 8;                 /* arrays kept per size */
+    static const size_t MAX_CACHED_BYTES = 16 << 20;    /* bytes kept per thread */
+
+    /* allocate - an array of at least n bins; n is rounded up to its actual size */
+    static T* allocate(size_t& n) {
+        size_t k = bucket(n);
+        n = (size_t) 1 << k;
+        Lists* l = lists();
+        if (l != NULL && k < BUCKETS) {
+            if (l->count[k] > 0) {
+                ++l->stats.pooled;
+                l->bytes -= n * sizeof(T);
+                return l->free[k][--l->count[k]];
+            }
+            ++l->stats.heap;
+        }
+        return new T[n];
+    }
+
+    /* release - give back an array of n bins, as sized by allocate() */
+    static void release(T* p, size_t n) {
+        size_t k = bucket(n);
+        Lists* l = lists();
+        if (l != NULL && k < BUCKETS && l->count[k] < MAX_CACHED && l->bytes + n * sizeof(T) <= MAX_CACHED_BYTES) {
+            l->free[k][l->count[k]++] = p;
+            l->bytes += n * sizeof(T);
+        } else {
+            delete[] p;
+        }
+    }
+
+    static BinPoolStats stats() {
+        Lists* l = lists();
+        BinPoolStats st = BinPoolStats();
+        if (l != NULL) {
+            st = l->stats;
+            st.cached = l->bytes;
+        }
+        return st;
+    }
+    static void reset_stats() {
+        if (Lists* l = lists())
+            l->stats = BinPoolStats();
+    }
+    /* trim - free the arrays this thread has cached */
+    static void trim() {
+        if (Lists* l = lists())
+            l->drain();
+    }
+  private:
+    struct Lists {
+        T* free[BUCKETS][MAX_CACHED];
+        size_t count[BUCKETS];
+        size_t bytes;
+        BinPoolStats stats;
+
+        Lists() : count(), bytes(0), stats() { }
+        ~Lists() {
+            drain();
+            dead = true;
+        }
+        void drain() {
+            for (size_t k = 0; k < BUCKETS; ++k)
+                while (count[k] > 0)
+                    delete[] free[k][--count[k]];
+            bytes = 0;
+        }
+    };
+    static thread_local Lists local;
+    static thread_local bool dead;
+
+    /* NULL once this thread's pool is gone (Ints in static storage outlive it) */
+    static inline Lists* lists() { return dead ? NULL : &local; }
+
+    static inline size_t bucket(size_t n) {
+        size_t k = 0;
+        while (((size_t) 1 << k) < n)
+            ++k;
+        return k;
+    }
+};
+
+template <typename T>
+thread_local typename BinPool<T>::Lists BinPool<T>::local;
+template <typename T>
+thread_local bool BinPool<T>::dead = false;
+
+/* BinBuffer - a fixed-size scratch array of bins from the thread's BinPool
+ *   For the temporaries of the bin loops (see BinOps), in place of a std::vector.
+ *   The bins start out zeroed.
+ */
+template <typename T>
+class BinBuffer {
+  public:
+    explicit BinBuffer(size_t n) : ptr(NULL), len(n), cap(n) {
+        if (n > 0) {
+            ptr = BinPool<T>::allocate(cap);
+            memset(ptr, 0, n * sizeof(T));
+        }
+    }
+    ~BinBuffer() {
+        if (ptr != NULL)
+            BinPool<T>::release(ptr, cap);
+    }
+    BinBuffer(const BinBuffer&) = delete;
+    BinBuffer& operator=(const BinBuffer&) = delete;
+
+    inline size_t size() const { return len; }
+    inline T* data() { return ptr; }
+    inline const T* data() const { return ptr; }
+    inline T& operator[](size_t i) { return ptr[i]; }
+    inline const T& operator[](size_t i) const { return ptr[i]; }
+  private:
+    T* ptr;
+    size_t len;
+    size_t cap;
+};
+
+/* BinStorage - a contiguous array of bins with a small inline buffer
+ *   This is the storage behind Int. The first N bins live inside the object
+ *   itself, so small numbers never touch the heap. Once a number outgrows the
+ *   inline buffer, the bins are moved to a heap array which grows geometrically.
+ *   Heap arrays are drawn from and returned to the thread's BinPool.
+ *
+ *   Moving a BinStorage hands over its heap array, so only copies of inline
+ *   bins are ever made on a move.
+ *
+ *   T must be a plain integer type: bins are copied with memcpy/memmove.
+ */
+template <typename T, size_t N>
+class BinStorage {
+  public:
+    BinStorage() : ptr(buf), len(0), cap(N) { }
+    BinStorage(size_t n, T val) : ptr(buf), len(0), cap(N) { resize(n, val); }
+    BinStorage(const BinStorage<T, N>& x) : ptr(buf), len(0), cap(N) { count_copy(x); assign(x.ptr, x.len); }
+    BinStorage(BinStorage<T, N>&& x) : ptr(buf), len(0), cap(N) { take(x); }
+    ~BinStorage() { release(); }
+
+    inline BinStorage<T, N>& operator=(const BinStorage<T, N>& x) {
+        if (this != &x) {
+            count_copy(x);
+            assign(x.ptr, x.len);
+        }
+        return *this;
+    }
+
+    inline BinStorage<T, N>& operator=(BinStorage<T, N>&& x) {
+        if (this != &x) {
+            release();
+            ptr = buf;
+            cap = N;
+            take(x);
+        }
+        return *this;
+    }
+
+    /* If set, called with the length of every copy of bins too large for the inline
+     * buffer (for tests; set it while no other thread is copying) */
+    static void (*heap_copy_hook)(size_t len);
+    /* How this thread's heap arrays were allocated (see BinPool) */
+    static inline BinPoolStats pool_stats() { return BinPool<T>::stats(); }
+    static inline void reset_pool_stats() { BinPool<T>::reset_stats(); }
+
+    inline size_t size() const { return len; }
+    inline size_t capacity() const { return cap; }
+    inline bool empty() const { return len == 0; }
+    inline bool is_inline() const { return ptr == buf; }
+
+    inline T* data() { return ptr; }
+    inline const T* data() const { return ptr; }
+    inline T& operator[](size_t i) { return ptr[i]; }
+    inline const T& operator[](size_t i) const { return ptr[i]; }
+    inline T& back() { return ptr[len - 1]; }
+    inline const T& back() const { return ptr[len - 1]; }
+
+    inline T& at(size_t i) {
+        if (i >= len)
+            throw std::out_of_range("BinStorage::at");
+        return ptr[i];
+    }
+    inline const T& at(size_t i) const {
+        if (i >= len)
+            throw std::out_of_range("BinStorage::at");
+        return ptr[i];
+    }
+
+    inline void clear() { len = 0; }
+    inline void pop_back() { --len; }
+    inline void push_back(T val) {
+        if (len == cap)
+            grow(len + 1);
+        ptr[len++] = val;
+    }
+
+    /* resize - change the number of bins, setting any new bins to val */
+    void resize(size_t n, T val = T()) {
+        if (n > cap)
+            grow(n);
+        for (size_t i = len; i < n; ++i)
+            ptr[i] = val;
+        len = n;
+    }
+
+    /* assign - replace the contents with the n bins starting at vals */
+    void assign(const T* vals, size_t n) {
+        if (n > cap)
+            grow_discard(n);
+        if (n > 0)
+            memmove(ptr, vals, n * sizeof(T));
+        len = n;
+    }
+
+    inline void reserve(size_t n) {
+        if (n > cap)
+            grow(n);
+    }
+
+    /* shift_up - insert amount zero bins at the front (index 0) */
+    void shift_up(size_t amount) {
+        if (amount == 0)
+            return;
+        if (len + amount > cap)
+            grow(len + amount);
+        memmove(ptr + amount, ptr, len * sizeof(T));
+        memset(ptr, 0, amount * sizeof(T));
+        len += amount;
+    }
+
+    /* shift_down - remove amount bins from the front (index 0) */
+    void shift_down(size_t amount) {
+        if (amount >= len) {
+            len = 0;
+            return;
+        }
+        memmove(ptr, ptr + amount, (len - amount) * sizeof(T));
+        len -= amount;
+    }
+
+    friend void swap(BinStorage<T, N>& a, BinStorage<T, N>& b) {
+        if (!a.is_inline() && !b.is_inline()) {
+            T* p = a.ptr; a.ptr = b.ptr; b.ptr = p;
+            size_t c = a.cap; a.cap = b.cap; b.cap = c;
+            size_t l = a.len; a.len = b.len; b.len = l;
+        } else if (a.is_inline() && b.is_inline()) {
+            T tmp[N];
+            memcpy(tmp, a.buf, a.len * sizeof(T));
+            memcpy(a.buf, b.buf, b.len * sizeof(T));
+            memcpy(b.buf, tmp, a.len * sizeof(T));
+            size_t l = a.len; a.len = b.len; b.len = l;
+        } else {
+            /* hand the heap array to the inline one, and copy the inline bins back */
+            BinStorage<T, N>& h = a.is_inline() ? b : a;
+            BinStorage<T, N>& s = a.is_inline() ? a : b;
+            T* p = h.ptr;
+            size_t c = h.cap, l = h.len;
+            memcpy(h.buf, s.buf, s.len * sizeof(T));
+            h.ptr = h.buf;
+            h.cap = N;
+            h.len = s.len;
+            s.ptr = p;
+            s.cap = c;
+            s.len = l;
+        }
+    }
+  private:
+    T* ptr;
+    size_t len;
+    size_t cap;
+    T buf[N];
+
+    inline void release() {
+        if (ptr != buf)
+            BinPool<T>::release(ptr, cap);
+    }
+
+    inline static void count_copy(const BinStorage<T, N>& x) {
+        if (x.len > N && heap_copy_hook != NULL)
+            heap_copy_hook(x.len);
+    }
+
+    /* take - move the contents of x into this (empty, inline) storage, leaving x empty */
+    void take(BinStorage<T, N>& x) {
+        if (x.is_inline()) {
+            memcpy(buf, x.buf, x.len * sizeof(T));
+            len = x.len;
+        } else {
+            ptr = x.ptr;
+            cap = x.cap;
+            len = x.len;
+            x.ptr = x.buf;
+            x.cap = N;
+        }
+        x.len = 0;
+    }
+
+    /* grow - reallocate to hold at least n bins, keeping the contents */
+    void grow(size_t n) {
+        size_t new_cap = (cap * 2 > n) ? cap * 2 : n;
+        T* p = BinPool<T>::allocate(new_cap);
+        if (len > 0)
+            memcpy(p, ptr, len * sizeof(T));
+        release();
+        ptr = p;
+        cap = new_cap;
+    }
+
+    /* grow_discard - reallocate to hold at least n bins, dropping the contents */
+    void grow_discard(size_t n) {
+        T* p = BinPool<T>::allocate(n);
+        release();
+        ptr = p;
+        cap = n;
+        len = 0;
+    }
+};
+
+template <typename T, size_t N>
+void (*BinStorage<T, N>::heap_copy_hook)(size_t) = NULL;
+
+#endif
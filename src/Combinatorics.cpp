@@ -0,0 +1,208 @@
+#include <vector>
+#include <algorithm>
+#include "Int.hpp"
+#include "Parallel.hpp"
+#include "Primes.hpp"
+
+/* Combinatorics.cpp - products of many factors, factorials and binomials
+ *
+ * Folding a list of factors into one accumulator multiplies a huge number by a small
+ * one over and over, which never gets past schoolbook multiplication. product()
+ * multiplies them pairwise instead, as a balanced tree: the leaves are the factors,
+ * and each node is the product of two halves of about the same size, so the big
+ * products are between numbers of the same size and go to Karatsuba, Toom or NTT.
+ *
+ * factorial() uses Luschny's prime swing: n! = (floor(n/2)!)^2 * swing(n), where
+ * swing(n) = n! / (floor(n/2)!)^2 is a product of primes below n, each to a power
+ * that is easy to work out (see odd_swing). The powers of two are left out and put
+ * back as one shift at the end. binomial() and multinomial() likewise count the
+ * power of each prime in the result (Legendre's formula) and multiply those up,
+ * except for the lopsided ones, which are a short product divided by small factorials.
+ *
+ * The prime powers are packed into int64_t leaves (mostly below 2^63, a couple of
+ * bins) before going into the tree.
+ */
+
+/* The fewest bits of factors in a subtree worth a task of its own in a parallel product */
+static const size_t PRODUCT_TASK_BITS = 1 << 14;
+
+/* tree_product - the product of x[lo..hi), split where the prefix sums of bit lengths
+ *   (bits[i] is the total over x[0..i)) reach half way, so the halves weigh about the same */
+static Int tree_product(const Int* x, const std::vector<size_t>& bits, size_t lo, size_t hi, bool parallel) {
+    if (hi - lo == 1)
+        return x[lo];
+    if (hi - lo == 2)
+        return x[lo] * x[lo + 1];
+    size_t half = bits[lo] + (bits[hi] - bits[lo]) / 2;
+    size_t mid = std::lower_bound(bits.begin() + lo + 1, bits.begin() + hi, half) - bits.begin();
+    if (mid >= hi)
+        mid = hi - 1;
+
+    Int left, right;
+    if (parallel && PARALLEL_THREADS > 1 && bits[hi] - bits[lo] >= PRODUCT_TASK_BITS) {
+        std::vector<Task> tasks;
+        tasks.push_back([&] { left = tree_product(x, bits, lo, mid, true); });
+        tasks.push_back([&] { right = tree_product(x, bits, mid, hi, true); });
+        parallel_run(tasks);
+    } else {
+        left = tree_product(x, bits, lo, mid, parallel);
+        right = tree_product(x, bits, mid, hi, parallel);
+    }
+    return left * right;
+}
+
+/* product - the product of all the factors (1 for none), as a balanced tree
+ *   With parallel set, and PARALLEL_THREADS above 1 (see Parallel.hpp), big enough
+ *   subtrees are multiplied out on separate threads.
+ */
+Int product(const std::vector<Int>& factors, bool parallel) {
+    if (factors.empty())
+        return Int(1);
+    std::vector<size_t> bits(factors.size() + 1, 0);
+    for (size_t i = 0; i < factors.size(); ++i) {
+        if (factors[i].equals_int32(0))
+            return Int(0);
+        bits[i + 1] = bits[i] + factors[i].bit_length();
+    }
+    return tree_product(factors.data(), bits, 0, factors.size(), parallel);
+}
+
+/* Leaves - small factors, packed into int64_t leaves for product() */
+class Leaves {
+  public:
+    Leaves() : acc(1) { }
+
+    inline void add(int64_t x) {
+        int64_t r;
+        if (mul_overflows(acc, x, r)) {
+            leaves.push_back(Int(acc));
+            acc = x;
+        } else {
+            acc = r;
+        }
+    }
+    inline void add_power(int64_t p, uint32_t e) {
+        for (uint32_t i = 0; i < e; ++i)
+            add(p);
+    }
+    Int product() {
+        if (acc != 1 || leaves.empty())
+            leaves.push_back(Int(acc));
+        acc = 1;
+        return ::product(leaves);
+    }
+  private:
+    int64_t acc;
+    std::vector<Int> leaves;
+};
+
+/* legendre - the power of the prime p in n! */
+static inline uint32_t legendre(uint32_t n, uint32_t p) {
+    uint32_t e = 0;
+    while (n >= p) {
+        n /= p;
+        e += n;
+    }
+    return e;
+}
+
+/* odd_swing - the odd part of swing(n) = n! / (floor(n/2)!)^2, from the odd primes <= n
+ *   The power of p in swing(n) is the number of odd terms among floor(n / p^i), i >= 1.
+ *   Above sqrt(n) there is at most one term, floor(n / p): it is 1 above n / 2, 2
+ *   above n / 3, and just needs its parity checked below that.
+ */
+static Int odd_swing(uint32_t n, const std::vector<uint64_t>& primes) {
+    Leaves l;
+    for (size_t i = 1; i < primes.size() && primes[i] <= n; ++i) {
+        uint32_t p = (uint32_t) primes[i];
+        if ((uint64_t) p * p > n) {
+            if (p > n / 2 || (n / p) % 2 == 1)
+                l.add(p);
+        } else {
+            for (uint32_t q = n / p; q > 0; q /= p)
+                if (q % 2 == 1)
+                    l.add(p);
+        }
+    }
+    return l.product();
+}
+
+/* odd_factorial - the odd part of n! */
+static Int odd_factorial(uint32_t n, const std::vector<uint64_t>& primes) {
+    if (n < 3)
+        return Int(1);
+    Int half = odd_factorial(n / 2, primes);
+    return half * half * odd_swing(n, primes);
+}
+
+/* factorial - n! */
+Int factorial(uint32_t n) {
+    if (n <= 20) {
+        int64_t f = 1;
+        for (uint32_t i = 2; i <= n; ++i)
+            f *= i;
+        return Int(f);
+    }
+    Int f = odd_factorial(n, primes_between(0, (uint64_t) n + 1));
+    uint32_t ones = 0;
+    for (uint32_t m = n; m > 0; m >>= 1)
+        ones += m & 1;
+    f.shift_left(n - ones);     // the power of two in n! is n minus the number of one bits in n
+    return f;
+}
+
+/* multinomial - (k_1 + ... + k_m)! / (k_1! ... k_m!)
+ *   The parts must add up to less than 2^32; this throws a domain_error otherwise.
+ *   When the biggest part, K, is most of the total N, this is the product of K + 1..N
+ *   over the factorials of the other parts, all of them short. Otherwise the power of
+ *   each prime p <= N is v(N) - v(k_1) - ... - v(k_m), where v(k) is its power in k!.
+ */
+Int multinomial(const std::vector<uint32_t>& parts) {
+    uint64_t total = 0;
+    uint32_t biggest = 0;
+    size_t at = 0;
+    for (size_t i = 0; i < parts.size(); ++i) {
+        total += parts[i];
+        if (parts[i] > biggest) {
+            biggest = parts[i];
+            at = i;
+        }
+    }
+    if (total > 0xFFFFFFFFULL)
+        throw std::domain_error("multinomial: the parts add up to 2^32 or more");
+    uint32_t n = (uint32_t) total;
+    if (n == biggest)
+        return Int(1);
+
+    if (n - biggest < n / 32) {
+        Leaves top;
+        for (uint64_t i = (uint64_t) biggest + 1; i <= n; ++i)
+            top.add((int64_t) i);
+        std::vector<Int> below;
+        for (size_t i = 0; i < parts.size(); ++i)
+            if (i != at && parts[i] > 1)
+                below.push_back(factorial(parts[i]));
+        return top.product() / product(below);
+    }
+
+    std::vector<uint64_t> primes = primes_between(0, (uint64_t) n + 1);
+    Leaves l;
+    for (size_t i = 0; i < primes.size(); ++i) {
+        uint32_t p = (uint32_t) primes[i], e = legendre(n, p);
+        for (size_t j = 0; j < parts.size() && e > 0; ++j)
+            if (parts[j] >= p)
+                e -= legendre(parts[j], p);
+        l.add_power(p, e);
+    }
+    return l.product();
+}
+
+/* binomial - n choose k; zero when k > n */
+Int binomial(uint32_t n, uint32_t k) {
+    if (k > n)
+        return Int(0);
+    std::vector<uint32_t> parts;
+    parts.push_back(k);
+    parts.push_back(n - k);
+    return multinomial(parts);
+}
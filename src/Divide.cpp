@@ -0,0 +1,181 @@
+#include <cstring>
+#include <cassert>
+#include "BinOps.hpp"
+#include "BinStorage.hpp"
+
+/* Divide.cpp - division algorithms on raw bins
+ *
+ * bins_divrem() is schoolbook long division (Knuth, TAOCP vol. 2, 4.3.1, Algorithm D).
+ * Each quotient bin is estimated from the top two bins of the running remainder and
+ * the top bin of the divisor. After normalizing the divisor so its top bit is set,
+ * the estimate is at most two too big, and a check against the next bin of the divisor
+ * almost always corrects it before the multiply-and-subtract is done.
+ *
+ * From DIV_DC_THRESHOLD bins in the divisor, bins_divrem() switches to recursive
+ * division (Burnikel and Ziegler, "Fast Recursive Division", 1998). A 2n by n bin
+ * division is done as two n by n/2 divisions on the top halves, each followed by
+ * one n/2 x n/2 product to fix up the rest of the remainder, so division costs a
+ * small multiple of one n x n multiplication instead of O(n^2).
+ */
+
+size_t DIV_DC_THRESHOLD = 40;
+
+/* bins_divrem_knuth - Algorithm D, for bn >= 2 and b[bn - 1] != 0
+ *   u is the normalized dividend (an + 1 bins) and is left holding the normalized remainder.
+ *   v is the normalized divisor (bn bins).
+ */
+static void bins_divrem_knuth(bin_t* q, bin_t* u, size_t an, const bin_t* v, size_t bn) {
+    const uint64_t B = (uint64_t) 1 << BINOPS_BITS;
+    const bin_t v1 = v[bn - 1], v2 = v[bn - 2];
+    uint64_t num, qhat, rhat;
+    bin_t borrow, top;
+    for (size_t j = an - bn + 1; j-- > 0; ) {
+        // estimate from the top two bins; this is at most two too big
+        num = ((uint64_t) u[j + bn] << BINOPS_BITS) | u[j + bn - 1];
+        qhat = num / v1;
+        rhat = num % v1;
+        while (qhat >= B || qhat * v2 > ((rhat << BINOPS_BITS) | u[j + bn - 2])) {
+            --qhat;
+            rhat += v1;
+            if (rhat >= B)
+                break;
+        }
+
+        // u[j .. j + bn] -= qhat * v; if that went negative, qhat was one too big
+        borrow = bins_submul_1(u + j, v, bn, (bin_t) qhat);
+        top = u[j + bn];
+        u[j + bn] = top - borrow;
+        if (top < borrow) {
+            --qhat;
+            u[j + bn] += bins_add(u + j, u + j, bn, v, bn);
+        }
+        if (q)
+            q[j] = (bin_t) qhat;
+    }
+}
+
+static size_t div_dc_threshold() {
+    return (DIV_DC_THRESHOLD < 4) ? 4 : DIV_DC_THRESHOLD;  // the halves need at least two bins
+}
+
+static bin_t div_dc(bin_t* q, bin_t* u, const bin_t* v, size_t n, bin_t* scratch);
+
+/* div_fixup - finish dividing the window u (an + k bins) after its top 2k bins were divided
+ * by the top k bins of v (v has an bins).
+ *   q (k bins) and qh hold that quotient, and u[an - k .. an) its remainder. The quotient
+ *   times the low an - k bins of v still has to come off, and since the estimate can be
+ *   a little too big, it is corrected by adding v back while that leaves u negative.
+ *   The result is in q and u[0..an), and the quotient's high bit is returned.
+ */
+static bin_t div_fixup(bin_t* q, bin_t qh, size_t k, bin_t* u, const bin_t* v, size_t an,
+                       bin_t* scratch) {
+    size_t lo = an - k;
+    bins_mul(scratch, q, k, v, lo);
+    bin_t borrow = bins_sub(u, u, an, scratch, an);
+    if (qh)
+        borrow += bins_sub(u + k, u + k, lo, v, lo);
+    while (borrow) {
+        qh -= bins_sub_1(q, q, k, 1);
+        borrow -= bins_add(u, u, an, v, an);
+    }
+    return qh;
+}
+
+/* div_dc - divide u (2n bins) by the normalized v (n bins)
+ *   The low n bins of the quotient go in q and the high bit is returned.
+ *   The remainder is left in u[0..n); u[n..2n) is garbage afterwards.
+ *   scratch needs n bins.
+ */
+static bin_t div_dc(bin_t* q, bin_t* u, const bin_t* v, size_t n, bin_t* scratch) {
+    bin_t qh;
+    if (n < div_dc_threshold()) {
+        qh = (bins_cmp(u + n, v, n) >= 0) ? 1 : 0;
+        if (qh)
+            bins_sub(u + n, u + n, n, v, n);
+        bins_divrem_knuth(q, u, 2 * n - 1, v, n);
+        return qh;
+    }
+    size_t lo = n / 2, hi = n - lo;
+
+    // the top hi quotient bins, from u[2lo .. 2n) / v[lo .. n)
+    qh = div_dc(q + lo, u + 2 * lo, v + lo, hi, scratch);
+    qh = div_fixup(q + lo, qh, hi, u + lo, v, n, scratch);
+
+    // the bottom lo quotient bins, from u[hi .. n + lo) / v[hi .. n). These can't
+    // overflow now that the remainder is less than v, so the high bit is dropped.
+    bin_t ql = div_dc(q, u + hi, v + hi, lo, scratch);
+    div_fixup(q, ql, lo, u, v, n, scratch);
+    return qh;
+}
+
+/* div_block - divide the window u (bn + k bins) by the normalized v (bn bins), for k <= bn
+ *   The top bn bins of u must be less than v, so the quotient fits in k bins.
+ */
+static void div_block(bin_t* q, bin_t* u, size_t k, const bin_t* v, size_t bn, bin_t* scratch) {
+    bin_t qh;
+    if (k == bn) {
+        qh = div_dc(q, u, v, bn, scratch);
+    } else if (k < div_dc_threshold()) {
+        bins_divrem_knuth(q, u, bn + k - 1, v, bn);
+        return;
+    } else {
+        // estimate from the top k bins of v, then fix up with the rest
+        qh = div_dc(q, u + bn - k, v + bn - k, k, scratch);
+        qh = div_fixup(q, qh, k, u, v, bn, scratch);
+    }
+    assert(qh == 0);
+}
+
+/* bins_divrem_dc - recursive division of the normalized u (an + 1 bins) by v (bn bins)
+ *   The quotient is found bn bins at a time from the top, each block a 2bn by bn division,
+ *   except the first, which takes whatever is left over.
+ */
+static void bins_divrem_dc(bin_t* q, bin_t* u, size_t an, const bin_t* v, size_t bn) {
+    size_t qn = an - bn + 1;
+    size_t j = qn, k = (qn - 1) % bn + 1;
+    BinBuffer<bin_t> scratch(bn), qtmp(q ? 0 : qn);
+    if (!q)
+        q = qtmp.data();
+    while (j > 0) {
+        j -= k;
+        div_block(q + j, u + j, k, v, bn, scratch.data());
+        k = bn;
+    }
+}
+
+void bins_divrem(bin_t* q, bin_t* r, const bin_t* a, size_t an, const bin_t* b, size_t bn) {
+    assert(an >= bn && bn >= 1 && b[bn - 1] != 0);
+    if (bn == 1) {
+        BinBuffer<bin_t> tmp(q ? 0 : an);
+        if (!q)
+            q = tmp.data();
+        bin_t rem = bins_divrem_1(q, a, an, b[0]);
+        if (r)
+            r[0] = rem;
+        return;
+    }
+
+    // normalize so the divisor's top bit is set
+    uint32_t shift = leading_zeros(b[bn - 1]);
+    BinBuffer<bin_t> u(an + 1), v(bn);
+    if (shift > 0) {
+        bins_lshift(v.data(), b, bn, shift);
+        u[an] = bins_lshift(u.data(), a, an, shift);
+    } else {
+        memcpy(v.data(), b, bn * sizeof(bin_t));
+        memcpy(u.data(), a, an * sizeof(bin_t));
+    }
+
+    if (bn >= div_dc_threshold())
+        bins_divrem_dc(q, u.data(), an, v.data(), bn);
+    else
+        bins_divrem_knuth(q, u.data(), an, v.data(), bn);
+
+    if (r) {
+        if (shift > 0)
+            bins_rshift(r, u.data(), bn, shift);
+        else
+            for (size_t i = 0; i < bn; ++i)
+                r[i] = u[i];
+    }
+}
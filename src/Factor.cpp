@@ -0,0 +1,485 @@
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include "Factor.hpp"
+#include "Primes.hpp"
+#include "Modular.hpp"
+#include "BinOps.hpp"
+
+/* Factor.cpp - integer factorization
+ *
+ * factor() takes the small primes out first, by trial division. What is left has
+ * no factor below FACTOR_TRIAL_LIMIT, and is split up one composite at a time:
+ * primes (is_prime(), Primes.cpp) and perfect powers are recognised straight away,
+ * and the rest go to two methods that each find some factor, not necessarily prime.
+ *
+ * Pollard's rho method iterates x -> x^2 + a mod n, which cycles mod a prime
+ * factor p after about sqrt(p) steps. Brent's variant finds the cycle by comparing
+ * against a saved x that moves to powers of two, and takes one gcd per RHO_BATCH
+ * steps (R. Brent, "An improved Monte Carlo factorization algorithm", 1980). It is
+ * quick for factors up to about 12 digits. Below 2^64 it runs on uint64_t.
+ *
+ * The elliptic curve method (H. Lenstra, 1987) finds p when a random curve has a
+ * smooth number of points mod p, and its cost depends on the size of p rather than
+ * of n. The curves are Montgomery curves By^2 = x^3 + Ax^2 + x from Suyama's
+ * parametrization, in (X : Z) coordinates so that no step needs an inverse
+ * (P. Montgomery, "Speeding the Pollard and elliptic curve methods of
+ * factorization", 1987). Stage one multiplies a point by every prime power up to B1;
+ * stage two catches one more prime q up to B2, writing q = mD +- j and collecting the
+ * differences of x(mDQ) and x(jQ) for all of them into one gcd.
+ */
+
+/* Trial division takes out the primes below this */
+static const uint32_t FACTOR_TRIAL_LIMIT = 1 << 14;
+/* Steps between gcds in Pollard-Brent rho (and between checks of the clock) */
+static const uint64_t RHO_BATCH = 128;
+/* ECM stage two's giant step, and how far it goes past B1 */
+static const uint32_t ECM_D = 210;
+static const uint64_t ECM_B2_RATIO = 50;
+
+/* ECM stages: B1, and curves to run at it */
+struct EcmStage {
+    uint64_t b1;
+    uint32_t curves;
+};
+static const EcmStage ECM_STAGES[] = {
+    { 2000, 25 }, { 11000, 90 }, { 50000, 300 }, { 250000, 700 }, { 1000000, 1800 }, { 3000000, 5100 }
+};
+static const size_t NUM_ECM_STAGES = sizeof(ECM_STAGES) / sizeof(ECM_STAGES[0]);
+
+/* gcd64 - the greatest common divisor (Stein's algorithm) */
+static uint64_t gcd64(uint64_t a, uint64_t b) {
+    if (a == 0 || b == 0)
+        return a | b;
+    uint32_t shift = 0;
+    while (((a | b) & 1) == 0) {
+        a >>= 1;
+        b >>= 1;
+        ++shift;
+    }
+    while ((a & 1) == 0)
+        a >>= 1;
+    while (b != 0) {
+        while ((b & 1) == 0)
+            b >>= 1;
+        if (a > b)
+            std::swap(a, b);
+        b -= a;
+    }
+    return a << shift;
+}
+
+/* rho_step64 - y^2 + a mod n, for y, a < n */
+static inline uint64_t rho_step64(uint64_t y, uint64_t a, uint64_t n) {
+    uint64_t t = mulmod64(y, y, n);
+    return (t >= n - a) ? t - (n - a) : t + a;
+}
+
+/* Point - the x coordinate of a point on a Montgomery curve, as X / Z */
+struct Point {
+    Int x, z;
+};
+
+/* Curve - x-only arithmetic on a Montgomery curve mod n, with a24 = (A + 2) / 4 */
+class Curve {
+  public:
+    Curve(const ModContext& mc, const Int& a24) : mc(mc), a24(a24) { }
+
+    /* 2P */
+    Point dbl(const Point& p) const {
+        Int s = mc.addmod(p.x, p.z), t = mc.submod(p.x, p.z);
+        s = mc.mulmod(s, s);
+        t = mc.mulmod(t, t);
+        Int w = mc.submod(s, t);
+        Point r = { mc.mulmod(s, t), mc.mulmod(w, mc.addmod(t, mc.mulmod(a24, w))) };
+        return r;
+    }
+    /* P + Q, given P - Q */
+    Point add(const Point& p, const Point& q, const Point& diff) const {
+        Int u = mc.mulmod(mc.submod(p.x, p.z), mc.addmod(q.x, q.z));
+        Int v = mc.mulmod(mc.addmod(p.x, p.z), mc.submod(q.x, q.z));
+        Int s = mc.addmod(u, v), t = mc.submod(u, v);
+        Point r = { mc.mulmod(diff.z, mc.mulmod(s, s)), mc.mulmod(diff.x, mc.mulmod(t, t)) };
+        return r;
+    }
+    /* kP, for k >= 1, by Montgomery's ladder (R1 - R0 = P throughout) */
+    Point mul(const Point& p, uint64_t k) const {
+        if (k == 1)
+            return p;
+        int32_t top = 63;
+        while ((k >> top) == 0)
+            --top;
+        Point r0 = p, r1 = dbl(p);
+        for (int32_t i = top - 1; i >= 0; --i) {
+            if ((k >> i) & 1) {
+                r0 = add(r1, r0, p);
+                r1 = dbl(r1);
+            } else {
+                r1 = add(r1, r0, p);
+                r0 = dbl(r0);
+            }
+        }
+        return r0;
+    }
+  private:
+    const ModContext& mc;
+    Int a24;
+};
+
+/* EcmBounds - the primes an ECM stage needs: the list up to B1, and flags up to B2
+ *   The flags cover odd numbers only (stage two only asks about mD +- j, which is
+ *   odd), and are sieved in place rather than built from a list.
+ */
+struct EcmBounds {
+    uint64_t b1, b2;
+    std::vector<uint64_t> primes;
+    std::vector<bool> composite;        // composite[i] for 2i + 1
+
+    explicit EcmBounds(uint64_t b1) : b1(b1), b2(b1 * ECM_B2_RATIO) {
+        primes = primes_between(0, b1 + 1);
+        uint64_t end = b2 + ECM_D;
+        composite.assign(end / 2 + 1, false);
+        composite[0] = true;
+        for (uint64_t p = 3; p * p < end; p += 2)
+            if (!composite[p / 2])
+                for (uint64_t q = p * p; q < end; q += 2 * p)
+                    composite[q / 2] = true;
+    }
+
+    /* whether the odd q < B2 + ECM_D is prime */
+    inline bool odd_prime(uint64_t q) const { return !composite[q / 2]; }
+};
+
+/* Factorizer - one call to factor(), with its budget, clock and findings so far */
+class Factorizer {
+  public:
+    explicit Factorizer(const FactorBudget& budget) : budget(budget), rho_used(0), curves_used(0) {
+        deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(budget.milliseconds);
+    }
+
+    Factorization run(const Int& n);
+  private:
+    const FactorBudget& budget;
+    std::chrono::steady_clock::time_point deadline;
+    uint64_t rho_used;          // rho steps and ECM curves spent so far, on all composites
+    uint32_t curves_used;
+    Factorization result;
+
+    inline bool out_of_time() const {
+        return budget.milliseconds > 0 && std::chrono::steady_clock::now() >= deadline;
+    }
+
+    void trial_divide(Int& m);
+    void split(const Int& c, uint32_t power);
+    void tidy();
+    bool rho64(uint64_t n, uint64_t& d);
+    bool rho(const Int& n, Int& d);
+    bool ecm(const Int& n, Int& d);
+    bool ecm_curve(const ModContext& mc, uint64_t sigma, const EcmBounds& bounds, Int& d);
+
+    /* v = x, if 0 <= x < 2^64 */
+    static inline bool to_u64(const Int& x, uint64_t& v) {
+        if (x.negative || x.bins.size() > 2)
+            return false;
+        v = x.bins[0] | ((x.bins.size() == 2) ? (uint64_t) x.bins[1] << Int::BIN_WIDTH : 0);
+        return true;
+    }
+    static inline Int from_u64(uint64_t v) {
+        Int x((int64_t) (v >> Int::BIN_WIDTH));
+        x.shift_left(Int::BIN_WIDTH);
+        return x + Int((int64_t) (v & 0xFFFFFFFFULL));
+    }
+};
+
+Factorization Factorizer::run(const Int& n) {
+    if (n.equals_int32(0))
+        throw std::domain_error("factor: zero has no factorization");
+    Int m(n);
+    m.negative = false;
+    trial_divide(m);
+    if (!m.equals_int32(1)) {
+        if (m < Int((int64_t) FACTOR_TRIAL_LIMIT * FACTOR_TRIAL_LIMIT))
+            result.primes.push_back(std::make_pair(m, 1));
+        else
+            split(m, 1);
+    }
+    tidy();
+    return result;
+}
+
+/* trial_divide - take the primes below FACTOR_TRIAL_LIMIT out of m, a bin's worth at a time */
+void Factorizer::trial_divide(Int& m) {
+    static const std::vector<uint64_t> small = primes_between(0, FACTOR_TRIAL_LIMIT);
+    Int q, r;
+    for (size_t i = 0; i < small.size() && !m.equals_int32(1); ) {
+        if (m < Int((int64_t) (small[i] * small[i])))
+            break;              // m is prime
+        size_t j = i;
+        uint64_t group = 1;
+        while (j < small.size() && group * small[j] <= 0xFFFFFFFFULL)
+            group *= small[j++];
+        // the primes that divide m also divide it after the others are taken out
+        Int::bin_t rest = bins_mod_1(m.bins.data(), m.bins.size(), (Int::bin_t) group);
+        for (; i < j; ++i) {
+            if (rest % small[i] != 0)
+                continue;
+            Int p((int64_t) small[i]);
+            uint32_t e = 0;
+            for (divmod(m, p, q, r); r.equals_int32(0); divmod(m, p, q, r)) {
+                swap(m, q);
+                ++e;
+            }
+            result.primes.push_back(std::make_pair(p, e));
+        }
+    }
+}
+
+/* split - add the factors of c, which has no factor below FACTOR_TRIAL_LIMIT, each to
+ *   power times its own power */
+void Factorizer::split(const Int& c, uint32_t power) {
+    if (c.equals_int32(1))
+        return;
+    if (is_prime(c)) {
+        result.primes.push_back(std::make_pair(c, power));
+        return;
+    }
+    Int base;
+    uint32_t exp;
+    if (is_perfect_power(c, base, exp)) {
+        split(base, power * exp);
+        return;
+    }
+
+    Int d;
+    uint64_t c64, d64;
+    bool found;
+    if (to_u64(c, c64)) {
+        found = rho64(c64, d64);
+        if (found)
+            d = from_u64(d64);
+    } else {
+        found = rho(c, d);
+    }
+    if (!found)
+        found = ecm(c, d);
+    if (!found) {
+        result.unfactored.push_back(std::make_pair(c, power));
+        return;
+    }
+    split(d, power);
+    split(c / d, power);
+}
+
+/* tidy - sort the primes and merge repeats, and take any of them out of the unfactored
+ *   composites (the two halves of a split may share a prime) */
+void Factorizer::tidy() {
+    std::vector<std::pair<Int, uint32_t> >& primes = result.primes;
+    std::vector<std::pair<Int, uint32_t> > left;
+    Int q, r;
+    for (size_t i = 0; i < result.unfactored.size(); ++i) {
+        Int u = result.unfactored[i].first;
+        uint32_t power = result.unfactored[i].second;
+        bool divided = false;
+        for (size_t j = 0, known = primes.size(); j < known; ++j) {
+            for (divmod(u, primes[j].first, q, r); r.equals_int32(0); divmod(u, primes[j].first, q, r)) {
+                swap(u, q);
+                primes.push_back(std::make_pair(primes[j].first, power));
+                divided = true;
+            }
+        }
+        if (divided && is_prime(u))
+            primes.push_back(std::make_pair(u, power));
+        else if (!u.equals_int32(1))
+            left.push_back(std::make_pair(u, power));
+    }
+    result.unfactored.swap(left);
+
+    std::sort(primes.begin(), primes.end(),
+              [](const std::pair<Int, uint32_t>& a, const std::pair<Int, uint32_t>& b) { return a.first < b.first; });
+    size_t k = 0;
+    for (size_t i = 0; i < primes.size(); ++i) {
+        if (k > 0 && primes[k - 1].first == primes[i].first)
+            primes[k - 1].second += primes[i].second;
+        else
+            primes[k++] = primes[i];
+    }
+    primes.resize(k);
+}
+
+/* rho64 - Pollard-Brent rho on a composite n < 2^64; d is a proper factor if found */
+bool Factorizer::rho64(uint64_t n, uint64_t& d) {
+    for (uint64_t a = 1; rho_used < budget.rho_steps; ++a) {
+        uint64_t x = 0, y = 2, ys = 2, q = 1, g = 1;
+        for (uint64_t r = 1; g == 1 && rho_used < budget.rho_steps; r *= 2) {
+            x = y;
+            for (uint64_t i = 0; i < r; ++i) {
+                if (i % RHO_BATCH == 0 && out_of_time())
+                    return false;
+                y = rho_step64(y, a, n);
+            }
+            for (uint64_t k = 0; k < r && g == 1; k += RHO_BATCH) {
+                if (out_of_time())
+                    return false;
+                ys = y;
+                for (uint64_t i = 0; i < RHO_BATCH && i < r - k; ++i) {
+                    y = rho_step64(y, a, n);
+                    q = mulmod64(q, (x > y) ? x - y : y - x, n);
+                }
+                g = gcd64(q, n);
+            }
+            rho_used += 2 * r;
+        }
+        if (g == n) {
+            // the batch overshot: go back over it a step at a time
+            do {
+                ys = rho_step64(ys, a, n);
+                g = gcd64((x > ys) ? x - ys : ys - x, n);
+            } while (g == 1);
+        }
+        if (g != 1 && g != n) {
+            d = g;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* rho - Pollard-Brent rho on a composite n; d is a proper factor if found */
+bool Factorizer::rho(const Int& n, Int& d) {
+    ModContext mc(n);
+    for (int64_t a = 1; rho_used < budget.rho_steps; ++a) {
+        Int c(a), x, y(2), ys(2), q(1), g(1);
+        for (uint64_t r = 1; g.equals_int32(1) && rho_used < budget.rho_steps; r *= 2) {
+            x = y;
+            for (uint64_t i = 0; i < r; ++i) {
+                if (i % RHO_BATCH == 0 && out_of_time())
+                    return false;
+                y = mc.addmod(mc.mulmod(y, y), c);
+            }
+            for (uint64_t k = 0; k < r && g.equals_int32(1); k += RHO_BATCH) {
+                if (out_of_time())
+                    return false;
+                ys = y;
+                for (uint64_t i = 0; i < RHO_BATCH && i < r - k; ++i) {
+                    y = mc.addmod(mc.mulmod(y, y), c);
+                    q = mc.mulmod(q, mc.submod(x, y));
+                }
+                g = gcd(q, n);
+            }
+            rho_used += 2 * r;
+        }
+        if (g == n) {
+            do {
+                ys = mc.addmod(mc.mulmod(ys, ys), c);
+                g = gcd(mc.submod(x, ys), n);
+            } while (g.equals_int32(1));
+        }
+        if (!g.equals_int32(1) && g != n) {
+            d = g;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* ecm - the elliptic curve method on a composite n; d is a proper factor if found
+ *   The curves go through ECM_STAGES, never past budget.ecm_max_b1, and stay at the
+ *   last B1 they reach until the budget's curves (shared by all the composites of
+ *   the call) run out.
+ */
+bool Factorizer::ecm(const Int& n, Int& d) {
+    ModContext mc(n);
+    size_t stage = 0;
+    uint32_t in_stage = 0;
+    uint64_t b1 = std::min(ECM_STAGES[0].b1, budget.ecm_max_b1);
+    if (b1 < 2 || curves_used >= budget.ecm_curves)
+        return false;
+    EcmBounds bounds(b1);
+    for (uint32_t curve = 0; curves_used < budget.ecm_curves; ++curve, ++in_stage) {
+        if (in_stage == ECM_STAGES[stage].curves && stage + 1 < NUM_ECM_STAGES && b1 < budget.ecm_max_b1) {
+            ++stage;
+            in_stage = 0;
+            b1 = std::min(ECM_STAGES[stage].b1, budget.ecm_max_b1);
+            bounds = EcmBounds(b1);
+        }
+        if (out_of_time())
+            return false;
+        ++curves_used;
+        if (ecm_curve(mc, 6 + curve, bounds, d))
+            return true;
+    }
+    return false;
+}
+
+/* ecm_curve - try the curve from Suyama's parametrization with sigma:
+ *   u = sigma^2 - 5, v = 4 sigma, the start point (u^3 : v^3), and
+ *   (A + 2) / 4 = (v - u)^3 (3u + v) / (16 u^3 v)
+ */
+bool Factorizer::ecm_curve(const ModContext& mc, uint64_t sigma, const EcmBounds& bounds, Int& d) {
+    const Int& n = mc.modulus();
+    Int s((int64_t) sigma);
+    Int u = mc.submod(mc.mulmod(s, s), Int(5)), v = mc.reduce(Int(4) * s);
+    Int u3 = mc.mulmod(mc.mulmod(u, u), u), w = mc.submod(v, u);
+    Int top = mc.mulmod(mc.mulmod(mc.mulmod(w, w), w), mc.addmod(mc.addmod(mc.addmod(u, u), u), v));
+    Int bottom = mc.mulmod(mc.reduce(Int(16)), mc.mulmod(u3, v));
+    Int g = gcd(bottom, n);
+    if (!g.equals_int32(1)) {
+        d = g;
+        return g != n;
+    }
+    Curve curve(mc, mc.mulmod(top, invmod(bottom, n)));
+    Point p = { u3, mc.mulmod(mc.mulmod(v, v), v) };
+
+    // stage one: p times every prime power up to B1, a 64-bit product of them at a time
+    uint64_t k = 1;
+    for (size_t i = 0; i < bounds.primes.size(); ++i) {
+        uint64_t pk = bounds.primes[i];
+        while (pk <= bounds.b1 / bounds.primes[i])
+            pk *= bounds.primes[i];
+        if (k > 0xFFFFFFFFFFFFFFFFULL / pk) {
+            p = curve.mul(p, k);
+            k = 1;
+            if (out_of_time())
+                return false;
+        }
+        k *= pk;
+    }
+    p = curve.mul(p, k);
+    g = gcd(p.z, n);
+    if (!g.equals_int32(1)) {
+        d = g;
+        return g != n;
+    }
+
+    // stage two: baby steps jQ for odd j < D / 2, giant steps mDQ
+    std::vector<Point> baby(ECM_D / 2);
+    Point p2 = curve.dbl(p);
+    baby[1] = p;
+    baby[3] = curve.add(p2, p, p);
+    for (uint32_t j = 5; j < ECM_D / 2; j += 2)
+        baby[j] = curve.add(baby[j - 2], p2, baby[j - 4]);
+    uint64_t m = std::max<uint64_t>(bounds.b1 / ECM_D, 2);
+    Point step = curve.mul(p, ECM_D), prev = curve.mul(p, (m - 1) * ECM_D), giant = curve.mul(p, m * ECM_D);
+    Int acc(1);
+    for (; m * ECM_D < bounds.b2; ++m) {
+        for (uint32_t j = 1; j < ECM_D / 2; j += 2) {
+            if ((j % 3 == 0 || j % 5 == 0 || j % 7 == 0) || !(bounds.odd_prime(m * ECM_D - j) || bounds.odd_prime(m * ECM_D + j)))
+                continue;
+            acc = mc.mulmod(acc, mc.submod(mc.mulmod(giant.x, baby[j].z), mc.mulmod(baby[j].x, giant.z)));
+        }
+        Point next = curve.add(giant, step, prev);
+        prev = giant;
+        giant = next;
+        if (m % 64 == 0 && out_of_time())
+            return false;
+    }
+    g = gcd(acc, n);
+    d = g;
+    return !g.equals_int32(1) && g != n;
+}
+
+Factorization factor(const Int& n, const FactorBudget& budget) {
+    Factorizer f(budget);
+    return f.run(n);
+}
@@ -0,0 +1,47 @@
+#ifndef _FACTOR_HPP_
+#define _FACTOR_HPP_
+#include <vector>
+#include <utility>
+#include "Int.hpp"
+
+/* FactorBudget - how hard one call to factor() works before giving up
+ *   The rho steps and ECM curves are spent across the whole call, not per composite.
+ *   ECM runs its curves in stages of growing B1 (2000, 11000, 50000, ...), the usual
+ *   schedule for factors of 15, 20, 25, ... digits, up to ecm_max_b1, and starts
+ *   over at the first stage for each new composite.
+ *
+ *   Curves get slow quickly: on a 100-digit number a curve at B1 = 50000 takes about
+ *   a second, and all 1115 default curves would take about an hour. So by default
+ *   the call also stops after 10 seconds, which is then its worst case, give or take
+ *   one step. Only the primality test of each composite isn't cut short, which adds
+ *   a fraction of a second past a few thousand bits. milliseconds = 0 lifts the
+ *   time limit and leaves just the step and curve counts.
+ */
+struct FactorBudget {
+    uint64_t rho_steps;         // Pollard-Brent iterations
+    uint32_t ecm_curves;        // elliptic curves, over all stages
+    uint64_t ecm_max_b1;        // the biggest stage one bound
+    uint32_t milliseconds;      // wall clock limit for the call; 0 for none
+
+    FactorBudget() : rho_steps(1 << 18), ecm_curves(1115), ecm_max_b1(250000), milliseconds(10000) { }
+};
+
+/* Factorization - the factors of |n|, as (factor, power) pairs
+ *   primes is in increasing order; its entries above 2^64 are Baillie-PSW probable
+ *   primes (see Primes.cpp). unfactored holds the composites that ran out of budget,
+ *   with no factor in common with the primes.
+ */
+struct Factorization {
+    std::vector<std::pair<Int, uint32_t> > primes;
+    std::vector<std::pair<Int, uint32_t> > unfactored;
+
+    inline bool complete() const { return unfactored.empty(); }
+};
+
+/* factor - the factorization of |n| (see Factor.cpp); throws a domain_error for 0
+ *   Small factors come out by trial division, then medium ones by Pollard-Brent rho,
+ *   then bigger ones by the elliptic curve method, as far as the budget allows.
+ */
+Factorization factor(const Int& n, const FactorBudget& budget = FactorBudget());
+
+#endif
@@ -99,28 +99,7 @@ Frac Frac::from_double(double x, int precision) {
 
 /* This always returns positive factors */
 Int Frac::GCD(const Int& x, const Int& y) {
-    Int absx = abs(x);
-    Int absy = abs(y);
-    if (absx < absy)
-        return nochecks_gcd(absy, absx);
-    else
-        return nochecks_gcd(absx, absy);
-}
-
-/* Assumes a and b are nonnegative, and that a > b  */
-Int Frac::nochecks_gcd(const Int& x, const Int& y) {
-    if (DEBUG_FRAC) {
-        cout << "nochecks_gcd(x=" << x << ", y=" << y << ")" << endl;
-    }
-    Int a = x;
-    Int b = y;
-    Int r;
-    while (!b.equals_int32(0)) {
-        r = a % b;
-        a = b;
-        b = r;
-    }
-    return a;
+    return gcd(x, y);
 }
 
 /* Parse a fraction of the basic form INT/INT
@@ -150,20 +129,22 @@ void Frac::normalize() {
         bb.negate();
         tt.negate();
     }
-    Int c = Frac::GCD(tt, bb);
+    Int c = gcd(tt, bb);
     if (DEBUG_FRAC) cout << "GCD = " << c << endl;
-    tt /= c;
-    bb /= c;
+    if (!c.equals_int32(1)) {
+        tt /= c;
+        bb /= c;
+    }
 }
 
 void operator+=(Frac& x, const Frac& y) {
-    x.tt = x.tt * y.bb + y.tt * x.bb;
+    x.tt = prod(x.tt, y.bb) + prod(y.tt, x.bb);
     x.bb *= y.bb;
     x.normalize();
 }
 
 void operator-=(Frac& x, const Frac& y) {
-    x.tt = x.tt * y.bb - y.tt * x.bb;
+    x.tt = prod(x.tt, y.bb) - prod(y.tt, x.bb);
     x.bb *= y.bb;
     x.normalize();
 }
@@ -191,12 +172,12 @@ Frac operator^(const Frac& x, const Int& a) {
 }
 
 void operator+=(Frac& x, const Int& a) {
-    x.tt += x.bb * a;
+    x.tt += prod(x.bb, a);
     x.normalize();
 }
 
 void operator-=(Frac& x, const Int& a) {
-    x.tt -= x.bb * a;
+    x.tt -= prod(x.bb, a);
     x.normalize();
 }
 
@@ -7,6 +7,7 @@
 #include <cmath>
 #include "common.hpp"
 #include "Int.hpp"
+#include "IntExpr.hpp"
 
 using namespace std;
 
@@ -44,18 +45,18 @@ class Frac {
     inline friend bool operator<=(const Frac& x, const Frac& y) { return !(y < x); }
     inline friend bool operator>=(const Frac& x, const Frac& y) { return !(x < y); }
     
-    friend Frac operator + (const Frac& x, const Frac& y) { return Frac(x.tt * y.bb + y.tt * x.bb, x.bb * y.bb); }
-    friend Frac operator - (const Frac& x, const Frac& y) { return Frac(x.tt * y.bb - y.tt * x.bb, x.bb * y.bb); }
+    friend Frac operator + (const Frac& x, const Frac& y) { return Frac(prod(x.tt, y.bb) + prod(y.tt, x.bb), x.bb * y.bb); }
+    friend Frac operator - (const Frac& x, const Frac& y) { return Frac(prod(x.tt, y.bb) - prod(y.tt, x.bb), x.bb * y.bb); }
     friend Frac operator * (const Frac& x, const Frac& y) { return Frac(x.tt * y.tt, x.bb * y.bb); }
     friend Frac operator / (const Frac& x, const Frac& y) { return Frac(x.tt * y.bb, x.bb * y.tt); }
     
-    friend Frac operator + (const Int& a, const Frac& x) { return Frac(a * x.bb + x.tt, x.bb); }
-    friend Frac operator - (const Int& a, const Frac& x) { return Frac(a * x.bb - x.tt, x.bb); }
+    friend Frac operator + (const Int& a, const Frac& x) { return Frac(prod(a, x.bb) + x.tt, x.bb); }
+    friend Frac operator - (const Int& a, const Frac& x) { return Frac(prod(a, x.bb) - x.tt, x.bb); }
     friend Frac operator * (const Int& a, const Frac& x) { return Frac(a * x.tt, x.bb); }
     friend Frac operator / (const Int& a, const Frac& x) { return Frac(a * x.bb, x.tt); }
 
-    friend Frac operator + (const Frac& x, const Int& a) { return Frac(x.tt + a * x.bb, x.bb); }
-    friend Frac operator - (const Frac& x, const Int& a) { return Frac(x.tt - a * x.bb, x.bb); }
+    friend Frac operator + (const Frac& x, const Int& a) { return Frac(x.tt + prod(a, x.bb), x.bb); }
+    friend Frac operator - (const Frac& x, const Int& a) { return Frac(x.tt - prod(a, x.bb), x.bb); }
     friend Frac operator * (const Frac& x, const Int& a) { return Frac(a * x.tt, x.bb); }
     friend Frac operator / (const Frac& x, const Int& a) { return Frac(x.tt, x.bb * a); }
     friend Frac operator ^ (const Frac& x, const Int& a); 
@@ -78,8 +79,6 @@ class Frac {
   private:
     Int tt, bb; /* top, bottom */
     void normalize(); 
-
-    static Int nochecks_gcd(const Int& a, const Int& b);
 };
 
 #endif
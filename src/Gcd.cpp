@@ -0,0 +1,298 @@
+#include <vector>
+#include <algorithm>
+#include "Int.hpp"
+#include "BinOps.hpp"
+
+/* Gcd.cpp - greatest common divisors
+ *
+ * gcd() is Lehmer's algorithm (Knuth, TAOCP vol. 2, 4.5.2, Algorithm L). The quotients
+ * in Euclid's algorithm are nearly always small, and the first several of them only
+ * depend on the leading bits of a and b. So Euclid's steps are run on the top 32 bits
+ * of each, collecting them in a 2x2 matrix of single-bin cofactors for as long as the
+ * quotients are sure to be the ones the full numbers would give. One pass over the bins
+ * then applies the matrix, which stands for a dozen or so full-size division steps.
+ * When the top bits can't settle even one quotient (b is much shorter than a, or the
+ * quotient is huge), a single long division step is done instead.
+ *
+ * Once both numbers fit in 64 bits the rest is binary GCD (Stein's algorithm), which
+ * only needs shifts and subtractions.
+ *
+ * xgcd() and invmod() run the same loop, and fold each batch's matrix (or quotient)
+ * into the Bezout coefficient of one operand as they go, so a batch costs a few
+ * single-bin passes over the coefficient rather than an Int temporary per step. The
+ * other coefficient, when it is wanted, comes from one division at the end.
+ */
+
+/* binary_gcd - gcd of two 64-bit numbers by Stein's algorithm */
+static uint64_t binary_gcd(uint64_t a, uint64_t b) {
+    if (a == 0)
+        return b;
+    if (b == 0)
+        return a;
+    uint32_t twos = 0;
+    while (((a | b) & 1) == 0) {
+        a >>= 1;
+        b >>= 1;
+        ++twos;
+    }
+    while ((a & 1) == 0)
+        a >>= 1;
+    do {                        // a is odd, so factors of 2 in b don't matter
+        while ((b & 1) == 0)
+            b >>= 1;
+        if (a > b)
+            std::swap(a, b);
+        b -= a;
+    } while (b != 0);
+    return a << twos;
+}
+
+/* Cofactors - the matrix of a run of Euclid's steps: (a, b) -> (A a + B b, C a + D b) */
+struct Cofactors {
+    int64_t A, B, C, D;
+};
+
+/* lehmer_cofactors - Euclid's steps on the top bits of a[0..n) >= b[0..n), for n >= 2
+ *   Both are cut to the 32 bits below the top bit of a. The quotient from those is
+ *   the true one when the two bounds (x + A) / (y + C) and (x + B) / (y + D) agree.
+ *   The cofactors stay below 2^32 in size and alternate in sign. Returns false if
+ *   not even one step could be taken.
+ */
+static bool lehmer_cofactors(const bin_t* a, const bin_t* b, size_t n, Cofactors& m) {
+    uint32_t s = leading_zeros(a[n - 1]);
+    int64_t x = (s == 0) ? a[n - 1] : (bin_t) ((a[n - 1] << s) | (a[n - 2] >> (BINOPS_BITS - s)));
+    int64_t y = (s == 0) ? b[n - 1] : (bin_t) ((b[n - 1] << s) | (b[n - 2] >> (BINOPS_BITS - s)));
+    int64_t A = 1, B = 0, C = 0, D = 1, q, t;
+    while (y + C != 0 && y + D != 0) {
+        q = (x + A) / (y + C);
+        if (q != (x + B) / (y + D))
+            break;
+        t = A - q * C; A = C; C = t;
+        t = B - q * D; B = D; D = t;
+        t = x - q * y; x = y; y = t;
+    }
+    m.A = A; m.B = B; m.C = C; m.D = D;
+    return B != 0;
+}
+
+/* combine - r[0..n) = u * a[0..n) + v * b[0..n), for u and v of opposite signs (or zero)
+ *   The result must be known to be in [0, 2^(32n)), so the arithmetic is done modulo
+ *   2^(32n) and the carries are dropped. r must not overlap a or b.
+ */
+static void combine(bin_t* r, const bin_t* a, const bin_t* b, size_t n, int64_t u, int64_t v) {
+    if (v <= 0) {
+        bins_mul_1(r, a, n, (bin_t) u);
+        bins_submul_1(r, b, n, (bin_t) -v);
+    } else {
+        bins_mul_1(r, b, n, (bin_t) v);
+        bins_submul_1(r, a, n, (bin_t) -u);
+    }
+}
+
+/* trimmed - the number of bins in x without leading zero bins */
+static inline size_t trimmed(const bin_t* x, size_t n) {
+    while (n > 0 && x[n - 1] == 0)
+        --n;
+    return n;
+}
+
+/* lehmer_loop - Euclid's algorithm on a[0..an) >= b[0..bn), until b is zero or an <= stop
+ *   a and b are buffers of the starting an bins, with zeros above bn. The policy P is
+ *   told each step taken, so it can follow the cofactors:
+ *      p.matrix(m)         - a batch of steps found from the top bits
+ *      p.quotient(q, qn)   - one long division step, with quotient q[0..qn)
+ */
+template <typename P>
+static void lehmer_loop(std::vector<bin_t>& a, size_t& an, std::vector<bin_t>& b, size_t& bn, size_t stop, P& p) {
+    std::vector<bin_t> t(a.size()), u(a.size());
+    Cofactors m;
+    while (an > stop && bn > 0) {
+        if (an >= 2 && bn + 1 >= an && lehmer_cofactors(a.data(), b.data(), an, m)) {
+            combine(t.data(), a.data(), b.data(), an, m.A, m.B);
+            combine(u.data(), a.data(), b.data(), an, m.C, m.D);
+            swap(a, t);
+            swap(b, u);
+            p.matrix(m);
+        } else {
+            // (a, b) = (b, a mod b) by long division
+            bins_divrem(u.data(), t.data(), a.data(), an, b.data(), bn);
+            p.quotient(u.data(), an - bn + 1);
+            std::fill(t.begin() + bn, t.begin() + an, 0);
+            swap(a, b);
+            swap(b, t);
+            an = bn;
+        }
+        an = trimmed(a.data(), an);
+        bn = trimmed(b.data(), an);
+    }
+}
+
+/* NoCofactors - the policy for lehmer_loop when only the gcd is wanted */
+struct NoCofactors {
+    inline void matrix(const Cofactors&) { }
+    inline void quotient(const bin_t*, size_t) { }
+};
+
+/* BezoutCofactors - the policy for lehmer_loop that follows one Bezout coefficient
+ *   With a = u0 x + (...) y and b = u1 x + (...) y for the starting x and y, each step
+ *   (a, b) -> (b, a - q b) makes u1 the new u0 and u0 - q u1 the new u1. The signs of
+ *   the u's alternate, so that is |u0| + q |u1|: only the sizes are kept, which never
+ *   need a subtraction, along with the sign of u0. A batch of steps from the top bits
+ *   takes |u0| |A| + |u1| |B| and |u0| |C| + |u1| |D| in the same way.
+ */
+class BezoutCofactors {
+  public:
+    /* follow the coefficient of the starting a (or of b, if of_a is false) */
+    explicit BezoutCofactors(bool of_a) : u0(1, of_a ? 1 : 0), u1(1, of_a ? 0 : 1), negative(!of_a) { }
+
+    void matrix(const Cofactors& m) {
+        size_t n = std::max(u0.size(), u1.size());
+        u0.resize(n, 0);
+        u1.resize(n, 0);
+        r.resize(n + 1);
+        r[n] = bins_mul_1(r.data(), u0.data(), n, magnitude(m.A));
+        r[n] += bins_addmul_1(r.data(), u1.data(), n, magnitude(m.B));
+        s.resize(n + 1);
+        s[n] = bins_mul_1(s.data(), u0.data(), n, magnitude(m.C));
+        s[n] += bins_addmul_1(s.data(), u1.data(), n, magnitude(m.D));
+        swap(u0, r);
+        swap(u1, s);
+        trim(u0);
+        trim(u1);
+        if (m.D < 0)                // an odd number of steps
+            negative = !negative;
+    }
+
+    void quotient(const bin_t* q, size_t qn) {
+        qn = trimmed(q, qn);
+        size_t n = std::max(u0.size(), qn + u1.size()) + 1;
+        r.assign(n, 0);
+        if (qn > 0)
+            bins_mul(r.data(), q, qn, u1.data(), u1.size());
+        bins_add(r.data(), r.data(), n, u0.data(), u0.size());
+        swap(u0, u1);
+        swap(u1, r);
+        trim(u1);
+        negative = !negative;
+    }
+
+    /* |u0|, the coefficient of the current a */
+    inline const std::vector<bin_t>& coefficient() const { return u0; }
+    inline bool is_negative() const { return negative; }
+  private:
+    std::vector<bin_t> u0, u1;
+    std::vector<bin_t> r, s;    // scratch
+    bool negative;              // the sign of u0; u1 has the other sign
+
+    static inline bin_t magnitude(int64_t c) { return (bin_t) ((c < 0) ? -c : c); }
+    static inline void trim(std::vector<bin_t>& u) { u.resize(std::max(trimmed(u.data(), u.size()), (size_t) 1)); }
+};
+
+/* magnitudes - the bins of |x| and |y|, larger first; returns whether they were swapped */
+static bool magnitudes(const Int::bins_t& x, const Int::bins_t& y, std::vector<bin_t>& a, size_t& an,
+                       std::vector<bin_t>& b, size_t& bn) {
+    const bin_t* xp = x.data();
+    const bin_t* yp = y.data();
+    an = trimmed(xp, x.size());
+    bn = trimmed(yp, y.size());
+    bool swapped = (an < bn || (an == bn && bins_cmp(xp, yp, an) < 0));
+    if (swapped) {
+        std::swap(xp, yp);
+        std::swap(an, bn);
+    }
+    a.assign(xp, xp + std::max(an, (size_t) 1));
+    b.assign(a.size(), 0);
+    std::copy(yp, yp + bn, b.begin());
+    return swapped;
+}
+
+/* gcd - the greatest common divisor of x and y, which is never negative
+ *   gcd(x, 0) = |x|, and so gcd(0, 0) = 0.
+ */
+Int gcd(const Int& x, const Int& y) {
+    Int g;
+    int64_t xs, ys;
+    uint64_t r;
+    if (x.small(xs) && y.small(ys)) {
+        r = binary_gcd((xs < 0) ? -xs : xs, (ys < 0) ? -ys : ys);
+    } else {
+        std::vector<bin_t> a, b;
+        size_t an, bn;
+        magnitudes(x.bins, y.bins, a, an, b, bn);
+        NoCofactors p;
+        lehmer_loop(a, an, b, bn, 2, p);
+        if (bn == 0) {
+            g.bins.assign(a.data(), std::max(an, (size_t) 1));
+            return g;
+        }
+        r = binary_gcd(a[0] | ((an > 1) ? (uint64_t) a[1] << BINOPS_BITS : 0),
+                       b[0] | ((bn > 1) ? (uint64_t) b[1] << BINOPS_BITS : 0));
+    }
+    g.bins[0] = (bin_t) r;
+    if ((r >> BINOPS_BITS) != 0)
+        g.bins.push_back((bin_t) (r >> BINOPS_BITS));
+    return g;
+}
+
+/* bezout - g = gcd(x, y) and the s with g = s x + t y for some t
+ *   The coefficients are the ones Euclid's algorithm gives, so |s| <= |y| / (2g) (when
+ *   g < |y|). Only s is followed through the steps.
+ */
+void bezout(const Int& x, const Int& y, Int& g, Int& s) {
+    std::vector<bin_t> a, b;
+    size_t an, bn;
+    bool swapped = magnitudes(x.bins, y.bins, a, an, b, bn);
+    BezoutCofactors p(!swapped);
+    lehmer_loop(a, an, b, bn, 0, p);
+
+    g.bins.assign(a.data(), std::max(an, (size_t) 1));
+    g.negative = false;
+    s.bins.assign(p.coefficient().data(), p.coefficient().size());
+    s.negative = p.is_negative() && !s.equals_int32(0);
+    if (x.negative)
+        s.negative = !s.negative && !s.equals_int32(0);
+}
+
+/* xgcd - g = gcd(x, y) (never negative) and Bezout coefficients with g = s x + t y
+ *   These are the minimal ones from Euclid's algorithm: |s| <= |y| / (2g) and
+ *   |t| <= |x| / (2g) when neither x nor y divides the other. With y = 0, s is the
+ *   sign of x and t = 0.
+ */
+void xgcd(const Int& x, const Int& y, Int& g, Int& s, Int& t) {
+    Int gx, sx, tx;
+    if (y.equals_int32(0)) {
+        gx = x;
+        gx.negative = false;
+        sx.set_value(x.equals_int32(0) ? 0 : x.negative ? -1 : 1);
+    } else {
+        bezout(x, y, gx, sx);
+        tx = gx;
+        tx.add_product(sx, x, true);    // t y = g - s x
+        tx /= y;
+    }
+    swap(g, gx);
+    swap(s, sx);
+    swap(t, tx);
+}
+
+/* invmod - the inverse of a modulo m, so a * invmod(a, m) = 1 mod m
+ *   As with % and powmod(), the result is zero or has the sign of m. This throws a
+ *   divide_by_zero_error when m is zero, and a domain_error when gcd(a, m) is not 1.
+ */
+Int invmod(const Int& a, const Int& m) {
+    if (m.equals_int32(0))
+        throw divide_by_zero_error();
+    Int mm(m);
+    mm.negative = false;
+    Int r = a % mm, g, s;
+    bezout(r, mm, g, s);
+    if (!g.equals_int32(1))
+        throw std::domain_error("invmod: not invertible");
+    if (mm.equals_int32(1))
+        s.set_value(0);
+    else if (s.negative)
+        s += mm;
+    if (m.negative && !s.equals_int32(0))
+        s += m;
+    return s;
+}
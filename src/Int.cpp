@@ -1,12 +1,15 @@
+#include <deque>
+#include <mutex>
 #include "Int.hpp"
+#include "BinOps.hpp"
+#include "SlidingWindow.hpp"
 
 // For debugging.
-std::ostream& operator<<(std::ostream& o, const std::deque<int32_t>& deque) {
-    std::deque<int32_t>::const_iterator i;
-    o << "Deque[";
-    for (i = deque.begin(); i < deque.end(); ++i) {
-        o << *i;
-        if (i < --deque.end()) {
+std::ostream& operator<<(std::ostream& o, const Int::bins_t& bins) {
+    o << "Bins[";
+    for (size_t i = 0; i < bins.size(); ++i) {
+        o << bins[i];
+        if (i + 1 < bins.size()) {
             o << ", ";
         }
     }
@@ -21,44 +24,171 @@ std::istream& operator>>(std::istream& i, Int& x) {
     return x.read(i);
 }
 
+/* Powers of ten that fit in a bin: POW10[k] == 10^k for 0 <= k <= DEC_WIDTH */
+static const Int::bin_t POW10[] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+size_t Int::RADIX_THRESHOLD = 30;
+
+/* Int::DigitWriter - buffered output of decimal digits to a stream or a string
+ *   print() goes through this so a huge number is written in large blocks
+ *   rather than one formatted chunk at a time.
+ */
+class Int::DigitWriter {
+  public:
+    explicit DigitWriter(std::ostream& o) : out(&o), str(NULL), len(0) { }
+    explicit DigitWriter(std::string& s) : out(NULL), str(&s), len(0) { }
+    ~DigitWriter() { flush(); }
+
+    inline void put(char c) {
+        if (len == sizeof(buf))
+            flush();
+        buf[len++] = c;
+    }
+    void put(const char* p, size_t n) {
+        while (n-- > 0)
+            put(*p++);
+    }
+    void flush() {
+        if (out)
+            out->write(buf, len);
+        else
+            str->append(buf, len);
+        len = 0;
+    }
+  private:
+    std::ostream* out;
+    std::string* str;
+    char buf[4096];
+    size_t len;
+};
+
+/* Int::dec_power - the cached value of 10^(DEC_WIDTH * 2^k)
+ *   Each power is the square of the one before. The cache is shared, so it is
+ *   locked while it grows; a deque keeps references to earlier powers valid.
+ */
+const Int& Int::dec_power(size_t k) {
+    static std::mutex lock;
+    static std::deque<Int> powers;
+    std::lock_guard<std::mutex> guard(lock);
+    if (powers.empty())
+        powers.push_back(Int(DEC_LIMIT));
+    while (powers.size() <= k) {
+        Int sq;
+        multiply(powers.back(), powers.back(), sq);
+        powers.push_back(sq);
+    }
+    return powers[k];
+}
+
+/* Int::write_digits - write the magnitude of x in decimal
+ *   When width is nonzero, this writes exactly width digits (padding with zeros).
+ *   Small numbers peel DEC_WIDTH digits at a time off the bottom with a short division.
+ *   Larger numbers are split by the cached power of ten nearest their square root,
+ *   and the two halves are written recursively, so the cost is a few divisions of
+ *   each size rather than O(n^2).
+ */
+void Int::write_digits(const Int& x, size_t width, DigitWriter& out) {
+    size_t n = x.bins.size();
+    while (n > 1 && x.bins[n - 1] == 0)
+        --n;                    // skip any zero top bins rather than copy x to clean them
+    if (n < RADIX_THRESHOLD || n < 3) {
+        std::vector<bin_t> a(x.bins.data(), x.bins.data() + n);
+        std::vector<char> digits;   // least significant first
+        while (n > 0) {
+            bin_t chunk = bins_divrem_1(a.data(), a.data(), n, DEC_LIMIT);
+            if (a[n - 1] == 0)
+                --n;
+            for (int32_t i = 0; i < DEC_WIDTH; ++i, chunk /= 10)
+                digits.push_back('0' + chunk % 10);
+        }
+        size_t len = digits.size();
+        while (len > 0 && digits[len - 1] == '0')
+            --len;
+        if (width == 0 && len == 0)
+            width = 1;              // zero is written as "0"
+        assert(width == 0 || len <= width);
+        for (size_t i = len; i < width; ++i)
+            out.put('0');
+        while (len-- > 0)
+            out.put(digits[len]);
+        return;
+    }
+
+    size_t k = 0;
+    while (2 * dec_power(k + 1).bins.size() <= n + 1)
+        ++k;
+    size_t split = ((size_t) DEC_WIDTH) << k;
+    const Int& p = dec_power(k);
+    size_t pn = p.bins.size();
+    Int q, r;                   // divide the magnitude; x may be negative
+    q.bins.resize(n - pn + 1);
+    r.bins.resize(pn);
+    bins_divrem(q.bins.data(), r.bins.data(), x.bins.data(), n, p.bins.data(), pn);
+    q.cleanBins();
+    r.cleanBins();
+    write_digits(q, (width == 0) ? 0 : width - split, out);
+    write_digits(r, split, out);
+}
+
+/* Int::read_digits - set *this to the (positive) value of n decimal digits
+ *   This is the reverse of write_digits: small inputs fold in DEC_WIDTH digits at a
+ *   time, and larger ones are split at a cached power of ten, converted recursively
+ *   and joined with one multiplication.
+ */
+void Int::read_digits(const char* digits, size_t n) {
+    if (n <= RADIX_THRESHOLD * (BIN_WIDTH * 3 / 10) || n <= (size_t) DEC_WIDTH * 2) {
+        set_value(0);
+        bins.reserve(n / (BIN_WIDTH * 3 / 10) + 1);    // each bin holds more than 9 digits
+        size_t k = n % DEC_WIDTH;
+        if (k == 0)
+            k = DEC_WIDTH;
+        for (size_t i = 0; i < n; i += k, k = DEC_WIDTH) {
+            bin_t chunk = 0;
+            for (size_t j = 0; j < k; ++j)
+                chunk = chunk * 10 + (digits[i + j] - '0');
+            multiply_by_int(*this, POW10[k], *this);
+            add_bin(chunk);
+        }
+        return;
+    }
+
+    size_t k = 0;
+    while ((((size_t) DEC_WIDTH) << (k + 1)) < n)
+        ++k;
+    size_t split = ((size_t) DEC_WIDTH) << k;  // the low part's length; n / 2 <= split < n
+    Int high, low;
+    high.read_digits(digits, n - split);
+    low.read_digits(digits + n - split, split);
+    multiply(high, dec_power(k), *this);
+    add(low);
+}
+
+/* Print in decimal (see write_digits) */
 std::ostream& Int::print(std::ostream& out) const {
+    DigitWriter writer(out);
     if (negative)
-        out << '-';
-    size_t i = 0;
-    int32_t x;
-    while (i < bins.size() && (x = get_bin_from_back(i)) == 0)
-        ++i;
-    if (i == bins.size()) {
-        out << (int32_t) 0;
-    } else {
-        out << get_bin_from_back(i);    // don't pad the most significant bin
-        ++i;
-        for (; i < bins.size(); ++i)
-            out << std::setw(BIN_WIDTH) << std::setfill('0') << get_bin_from_back(i);
-    }
+        writer.put('-');
+    write_digits(*this, 0, writer);
     return out;
 }
 
-/* parse_int - read an positive int from the stringstream
- *   Made specifically for use with Int::read()
- *   This consumes no more than max_digits characters from the stream
- *      and only consumes digit characters [0-9].
- *
- *   This throws an invalid_argument exception if x contains anything other
- *   than an int. Use while constructing an Int from a string.
- */
-int32_t parse_int(std::stringstream& ss, int max_digits) {
-    std::stringstream s_num;
-    int i = 0;
-    while (i < max_digits && isdigit(ss.peek())) {
-        s_num << (char) ss.get();
-        ++i;
+/* Int::to_string - the decimal representation, as print() would write it */
+std::string Int::to_string() const {
+    std::string s;
+    {
+        DigitWriter writer(s);  // flushes into s when it goes out of scope
+        if (negative)
+            writer.put('-');
+        write_digits(*this, 0, writer);
     }
-    int32_t val;
-    s_num >> val;
-    if (s_num.fail() || !s_num.eof())
-        throw std::invalid_argument("Failed to parse int from '" + s_num.str() + "'");
-    return val;
+    return s;
+}
+
+/* Int::from_string - parse an Int from a string; this is the same as Int(x) */
+Int Int::from_string(const std::string& x) {
+    return Int(x);
 }
 
 /* Read an Int from the given stream into this object
@@ -66,8 +196,7 @@ int32_t parse_int(std::stringstream& ss, int max_digits) {
  *   This destroys the contents of this Int instance used
  *
  * Note:
- *   This should not throw an exception. The call to parse_int is
- *   setup in a way that should not trigger the exception.
+ *   This does not throw; a malformed number sets the failbit on the stream.
  */
 std::istream& Int::read(std::istream& in) {
     // check whether the stream is in a good state
@@ -75,10 +204,11 @@ std::istream& Int::read(std::istream& in) {
     if (!s)
         return in;
 
+    bool is_neg;
     if (in.peek() == '-') {
         in.get();
         if (isdigit(in.peek())) {
-            negative = true;
+            is_neg = true;
         } else {
             in.unget();
             in.setstate(std::ios::failbit);
@@ -86,7 +216,7 @@ std::istream& Int::read(std::istream& in) {
         }
     } else {
         if (isdigit(in.peek())) {
-            negative = false;
+            is_neg = false;
         } else {
             in.setstate(std::ios::failbit);
             return in;
@@ -100,79 +230,89 @@ std::istream& Int::read(std::istream& in) {
     }
 
     // read all digits; we need to know the number of digits
-    std::stringstream digit_ss;
+    std::string digits;
     while (isdigit(in.peek()))
-        digit_ss << (char) in.get();
+        digits.push_back((char) in.get());
 
-    int num_digits = digit_ss.str().size();
-    int count = 0;
-    int k, n;
-    if (num_digits == 0) {  // number is zero
+    if (digits.empty()) {  // number is zero
         // in.get() sets the failbit on eof but we have not failed, so unset the failbit
         // (It will be re-set on later calls to get() on the stream)
         in.clear(in.rdstate() & ~std::ios::failbit);  // clear(flags) sets all the flags as given
         set_value(0);
         return in;
-    } else if ((k = num_digits % BIN_WIDTH) > 0) {  // last bin size <= BIN_WIDTH
-        n = parse_int(digit_ss, k);
-        bins.push_front(n);
-        count += k;
-    }
-    while (count < num_digits) {        // all other bin sizes == BIN_WIDTH
-        n = parse_int(digit_ss, BIN_WIDTH);
-        bins.push_front(n);
-        count += BIN_WIDTH;
     }
 
+    read_digits(digits.data(), digits.size());
+    negative = is_neg;
+
     return in;
 }
 
 Int operator+(const Int& x, const Int& y) {
-    if (x.negative && y.negative)        // (-x) + (-y) --> -(x + y)
-        return -(-x + (-y));
-    else if (x.negative && !y.negative)  // (-x) + y --> -(x - y)
-        return -(-x - y);
-    else if (!x.negative && y.negative)  // x + (-y) --> x - y
-        return x - (-y);
-
-    if (x.bins.size() > y.bins.size()) {
+    // copy the longer one, so the sum only grows by a carry
+    if (x.bins.size() >= y.bins.size()) {
         Int r(x);
-        r.add(y);
+        r.add_signed(y, y.negative);
         return r;
     } else {
         Int r(y);
-        r.add(x);
+        r.add_signed(x, x.negative);
         return r;
     }
 }
 
 Int operator-(const Int& x, const Int& y) {
-    if (x.negative && y.negative)        // -x - (-y) --> -(x - y)
-        return -(-x - (-y));
-    else if (x.negative && !y.negative)  // -x - y --> -(x + y)
-        return -(-x + y);
-    else if (!x.negative && y.negative)  // x - (-y) --> x + y
-        return x + (-y);
-
-    if (x > y) {
+    if (x.bins.size() >= y.bins.size()) {
         Int r(x);
-        r.cleanBins();
-        r.subtract(y);
+        r.add_signed(y, !y.negative);
         return r;
-    } else {
+    } else {            // x - y --> -(y - x)
         Int r(y);
-        r.cleanBins();
-        r.subtract(x);
-        return -r;
+        r.add_signed(x, !x.negative);
+        r.negate();
+        return r;
     }
 }
 
+Int operator+(Int&& x, const Int& y) {
+    x.add_signed(y, y.negative);
+    return std::move(x);
+}
+
+Int operator+(const Int& x, Int&& y) {
+    y.add_signed(x, x.negative);
+    return std::move(y);
+}
+
+Int operator+(Int&& x, Int&& y) {
+    if (y.bins.capacity() > x.bins.capacity())
+        return std::move(y) + x;
+    return std::move(x) + y;
+}
+
+Int operator-(Int&& x, const Int& y) {
+    x.add_signed(y, !y.negative);
+    return std::move(x);
+}
+
+Int operator-(const Int& x, Int&& y) {  // x - y --> -(y - x)
+    y.add_signed(x, !x.negative);
+    y.negate();
+    return std::move(y);
+}
+
+Int operator-(Int&& x, Int&& y) {
+    if (y.bins.capacity() > x.bins.capacity())
+        return x - std::move(y);
+    return std::move(x) - y;
+}
+
 Int operator*(const Int& x, const Int& y) {
+    int64_t a, b, p;
+    if (x.small(a) && y.small(b) && !mul_overflows(a, b, p))
+        return Int(p);
     Int r;
-    if (x.bins.size() > y.bins.size())
-        multiply(x, y, r);
-    else
-        multiply(y, x, r);
+    multiply(x, y, r);
 
     if (x.negative != y.negative)
         r.negate();
@@ -186,8 +326,8 @@ Int operator/(const Int& x, const Int& y) {
 }
 
 Int operator%(const Int& x, const Int& y) {
-    Int r;
-    modulo(x, y, r);
+    Int q, r;
+    divmod(x, y, q, r);
     return r;
 }
 
@@ -197,68 +337,53 @@ Int operator^(const Int& x, const Int& y) {
     return r;
 }
 
+Int operator/(Int&& x, const Int& y) {
+    x /= y;
+    return std::move(x);
+}
+
+Int operator%(Int&& x, const Int& y) {
+    x %= y;
+    return std::move(x);
+}
+
 void Int::operator+=(const Int& other) {
-    if (negative && other.negative) {         // (-x) + (-y) --> -(x + y)
-        Int tmp = -other;   // needed if x and y same instance
-        negate();
-        (*this) += tmp;
-        negate();
-    } else if (negative && !other.negative) { // (-x) + y --> -(x - y)
-        negate();
-        (*this) -= other;
-        negate();
-    } else if (!negative && other.negative) { // x + (-y) --> x - y
-        (*this) -= (-other);
-    } else {
-        add(Int(other));  // copy in case same instance
-    }
+    add_signed(other, other.negative);
 }
 
 void Int::operator-=(const Int& other) {
-    if (negative && other.negative) {         // -x - (-y) --> -(x - y)
-        Int tmp = -other;
-        negate();
-        (*this) -= tmp;
-        negate();
-    } else if (negative && !other.negative) { // -x - y --> -(x + y)
-        negate();
-        (*this) += other;
-        negate();
-    } else if (!negative && other.negative) { // x - (-y) --> x + y
-        (*this) += (-other);
-    } else {
-        if (*this > other) {
-            subtract(other);
-        } else {
-            Int r(other);
-            r.subtract(*this);
-            r.negate();
-            return std::swap(*this, r);
-        }
-    }
+    add_signed(other, !other.negative);
 }
 
 void Int::operator*=(const Int& other) {
+    int64_t a, b, p;
+    if (small(a) && other.small(b) && !mul_overflows(a, b, p)) {
+        set_small(p);
+        return;
+    }
     Int r;
     multiply(*this, other, r);
-    r.negative = (negative != other.negative);
-    std::swap(*this, r);
+    if (negative != other.negative)
+        r.negate();             // leaves a zero product positive
+    swap(*this, r);
 }
 
 void Int::operator/=(const Int& other) {
-    divide(Int(other));  // copy y in case x and y are the same instance
+    if (&other == this)
+        divide(Int(other));  // copy y when x and y are the same instance
+    else
+        divide(other);
 }
 
 void Int::operator%=(const Int& other) {
-    Int r;
-    modulo(*this, other, r);
-    std::swap(*this, r);
+    Int q;
+    divmod(*this, other, q, *this);
 }
 
 void Int::operator^=(const Int& other) {
     Int r;
     exponentiate(*this, other, r);
-    std::swap(*this, r);
+    swap(*this, r);
 }
 
 Int operator-(const Int& x) {
@@ -267,6 +392,11 @@ Int operator-(const Int& x) {
     return y;
 }
 
+Int operator-(Int&& x) {
+    x.negate();
+    return std::move(x);
+}
+
 /* Default constructor - zero is the default value
  * bins(1, 0) says size = 1 and value = 0.
  */
@@ -278,20 +408,15 @@ Int::Int() : bins(1, 0), negative(false) {
  *   That is, after construction, *this will have the value x * (BIN_LIMIT ^ shift).
  *   (This is used in multiplication and division)
  */
-Int::Int(int64_t x, size_t shift) : bins(shift, 0), negative(false) {
-    if (x < 0) {
-        negative = true;
-        x = -x;
-    } else if (x == 0) {
+Int::Int(int64_t x, size_t shift) : bins(shift, 0), negative(x < 0) {
+    uint64_t m = (x < 0) ? -((uint64_t) x) : (uint64_t) x;
+    if (m == 0) {
         set_value(0);
         return;
     }
-    while (x >= BIN_LIMIT) {
-        bins.push_back(x % BIN_LIMIT);
-        x /= BIN_LIMIT;
-    }
-    if (x > 0)
-        bins.push_back((int32_t) x);
+    bins.push_back((bin_t) m);
+    if (m >> BIN_WIDTH)
+        bins.push_back((bin_t) (m >> BIN_WIDTH));
 }
 
 /* Construct from an Int and apply a shift.
@@ -299,44 +424,64 @@ Int::Int(int64_t x, size_t shift) : bins(shift, 0), negative(false) {
  *   That is, after construction, *this will have the value x * (BIN_LIMIT ^ shift).
  *   (This is used in multiplication and division)
  */
-Int::Int(const Int& x, size_t shift) : bins(shift, 0), negative(x.negative) {
-    for (size_t i = 0; i < x.bins.size(); ++i)
-		bins.push_back(x.bins.at(i));
+Int::Int(const Int& x, size_t shift) : bins(x.bins), negative(x.negative) {
+    bins.shift_up(shift);
 }
 
 /* Construct an Int from a std::string.
  *   The string can be of the format: [-][0-9]+
  *
- * This throws an invalid_argument exception when unable to convert any part
- *   of x to an int (see parse_int)
+ * This throws an invalid_argument exception when x is not entirely an Int.
  */
 Int::Int(const std::string& x) : negative(false) {
-    std::stringstream ss(x);
-    read(ss);
-    if (ss.fail() || !ss.eof()) {
-        set_value(0);
+    if (!parse(x.data(), x.data() + x.size()))
         throw std::invalid_argument("Failed to parse Int from '" + x + "'");
+}
+
+/* Int::parse - set *this to the Int in the characters [first, last)
+ *   The range must be exactly of the format: [-][0-9]+
+ *   This returns false (and sets *this to zero) otherwise. It never throws, and digits
+ *   are converted straight from the range, so parsing a number that fits in the inline
+ *   bins does not allocate.
+ */
+bool Int::parse(const char* first, const char* last) {
+    bool is_neg = false;
+    if (first != last && *first == '-') {
+        is_neg = true;
+        ++first;
+    }
+    if (first == last) {
+        set_value(0);
+        return false;
+    }
+    for (const char* p = first; p != last; ++p) {
+        if (*p < '0' || *p > '9') {
+            set_value(0);
+            return false;
+        }
     }
+    while (last - first > 1 && *first == '0')  // skip leading zeroes
+        ++first;
+    read_digits(first, last - first);
+    negative = is_neg && !equals_int32(0);
+    return true;
 }
 
-/* Int::is_int - return true if the value of *this is equal to x */
+/* Int::equals_int32 - return true if the value of *this is equal to x */
 bool Int::equals_int32(int32_t x) const {
-    int32_t val = abs(x);
-    size_t i = 0;
-    for (; i < bins.size() - 1; ++i)
-        if (bins.at(i))
+    bin_t val = (bin_t) abs((int64_t) x);
+    if (bins[0] != val)
+        return false;
+    for (size_t i = 1; i < bins.size(); ++i)  // the value is all in the lowest bin
+        if (bins[i])
             return false;
-	if (bins.at(i) == val && negative == (x < 0))
-        return true;
-	else if (bins.at(i) == val && val == 0)
-        return true;
-    return false;
+    return val == 0 || negative == (x < 0);
 }
 
 /* Int::set_int - set the value of *this to val with correct sign */
 void Int::set_value(int32_t val) {
     bins.clear();
-    bins.push_back(abs(val));
+    bins.push_back((bin_t) abs((int64_t) val));
     negative = (val < 0);
 }
 
@@ -346,19 +491,14 @@ void Int::set_value(int32_t val) {
  *          0 if equal
  */
 int32_t Int::cmp_bins(const Int& x) const {
-    int32_t tmp;
-    int32_t offset = x.bins.size() - bins.size();
-    if (offset < 0) {
+    size_t n = bins.size(), xn = x.bins.size();
+    if (n < xn) {
         return -x.cmp_bins(*this);
-    } else if (offset > 0) {  // x has more bins
-        for (int32_t i = 0; i < offset; ++i)
-            if (x.get_bin_from_back(i) != 0)
-                return -1;
     }
-    for (size_t i = 0; i < bins.size(); ++i)
-        if ((tmp = cmp_ints(get_bin_from_back(i), x.get_bin_from_back(offset + i))))
-            return tmp;
-    return 0;
+    for (size_t i = n; i > xn; --i)  // any extra bins could be leading zeros
+        if (bins[i - 1] != 0)
+            return 1;
+    return bins_cmp(bins.data(), x.bins.data(), xn);
 }
 
 void Int::cleanBins() {
@@ -375,6 +515,9 @@ void Int::cleanBins() {
  *          0 if equal
  */
 int32_t Int::cmp(const Int& x) const {
+    int64_t a, b;
+    if (small(a) && x.small(b))
+        return (a < b) ? -1 : (a > b) ? 1 : 0;
     int32_t bin_cmp = cmp_bins(x);
     if (bin_cmp == 0 && equals_int32(0)) {
         return 0;
@@ -392,35 +535,96 @@ int32_t Int::cmp(const Int& x) const {
 
 /* Int::add - add x to *this, ignoring signs */
 void Int::add(const Int& x) {
-    if (x.bins.size() > bins.size())
-        bins.resize(x.bins.size(), 0);
-    int32_t carry = 0;
-    int32_t sum, val;
-    size_t i = 0;
-    for (; i < x.bins.size(); ++i) {
-		sum = bins.at(i) + x.bins.at(i) + carry;
-        val = sum % BIN_LIMIT;
-        carry = max(0, sum / BIN_LIMIT);
-		bins.at(i) = val;
-    }
-    while (carry != 0 && i < bins.size()) {
-		sum = bins.at(i) + carry;
-        val = sum % BIN_LIMIT;
-        carry = max(0, sum / BIN_LIMIT);
-		bins.at(i) = val;
-        ++i;
-    }
+    size_t xn = x.bins.size();
+    if (xn > bins.size())
+        bins.resize(xn, 0);
+    bin_t carry = bins_add(bins.data(), bins.data(), bins.size(), x.bins.data(), xn);
     if (carry != 0)
         bins.push_back(carry);
 }
 
+/* Int::add_bin - add a single bin to *this, ignoring signs */
+void Int::add_bin(bin_t x) {
+    uint64_t carry = x;
+    for (size_t i = 0; carry != 0 && i < bins.size(); ++i) {
+        carry += bins[i];
+        bins[i] = (bin_t) carry;
+        carry >>= BIN_WIDTH;
+    }
+    if (carry != 0)
+        bins.push_back((bin_t) carry);
+}
+
+/* Int::add_signed - add x to *this, taking x to be negative when x_negative is set
+ *   This is += (and -=, with x_negative flipped) without negating a copy of x.
+ *   When |x| is the larger, |x| - |*this| is taken in place in the bins of *this.
+ *   This is safe to use when x and *this are the same instance.
+ */
+void Int::add_signed(const Int& x, bool x_negative) {
+    int64_t a, b, sum;
+    if (small(a) && x.small(b)) {
+        if (x_negative != x.negative)
+            b = -b;
+        if (!add_overflows(a, b, sum)) {
+            set_small(sum);
+            return;
+        }
+    }
+    if (negative == x_negative) {   // same signs: the magnitudes add
+        add(x);
+        return;
+    }
+    cleanBins();
+    int32_t c = cmp_bins(x);
+    if (c == 0) {
+        set_value(0);
+    } else if (c > 0) {             // the sign of *this stays
+        subtract(x);
+    } else {                        // the sign of x wins
+        size_t n = bins.size(), xn = x.bins.size();
+        bins.resize(xn, 0);
+        bins_sub(bins.data(), x.bins.data(), xn, bins.data(), n);
+        cleanBins();
+        negative = x_negative;
+    }
+}
+
+/* Int::add_product - add a * b to *this (or subtract it, if subtract is set)
+ *   The product is accumulated straight into the bins of *this (see bins_addmul).
+ *   When the signs differ, the product is subtracted from the bins; if that
+ *   borrows out of the top, the result changed sign and the bins hold its two's
+ *   complement, so they are negated back.
+ */
+void Int::add_product(const Int& a, const Int& b, bool subtract) {
+    if (&a == this || &b == this) {
+        Int p(a * b);
+        add_signed(p, p.negative != subtract);
+        return;
+    }
+    bool product_negative = (a.negative != b.negative) != subtract;
+    if (equals_int32(0)) {
+        multiply(a, b, *this);
+        negative = product_negative && !equals_int32(0);
+        return;
+    }
+    size_t an = a.bins.size(), bn = b.bins.size();
+    size_t n = ((bins.size() > an + bn) ? bins.size() : an + bn) + 1;
+    bins.resize(n, 0);
+    if (negative == product_negative) {
+        bins_addmul(bins.data(), n, a.bins.data(), an, b.bins.data(), bn);
+    } else if (bins_submul(bins.data(), n, a.bins.data(), an, b.bins.data(), bn) != 0) {
+        bins_neg(bins.data(), bins.data(), n);
+        negative = !negative;
+    }
+    cleanBins();
+    if (equals_int32(0))
+        negative = false;
+}
+
 /* Int::subtract - subtract off x from *this
  *   This ignores signs and assumes that *this is larger than or equal to x in absolute value.
  */
 void Int::subtract(const Int& x) {
-    int32_t diff;
-    int32_t borrow = 0;
-    size_t i = 0;
     if (DEBUG_INT_SUBTRACT) std::cout << "Subtracting: " << std::endl
               << "    " << *this << std::endl
               << "  - " << x << std::endl
@@ -431,176 +635,140 @@ void Int::subtract(const Int& x) {
               << "  x.bins.size() = " << x.bins.size() << std::endl;
     if (bins.size() > 1) assert(bins.back() != 0);
     if (x.bins.size() > 1) assert(x.bins.back() != 0);
-    assert(abs(*this) >= abs(x));
-    for (; i < x.bins.size(); ++i) {
-        if (DEBUG_INT_SUBTRACT) std::cout << " i = " << i << "(subtract)" << std::endl;
-        if (DEBUG_INT_SUBTRACT) std::cout << "  *this = " << *this << std::endl;
-		diff = bins.at(i) - borrow - x.bins.at(i);
-        if (DEBUG_INT_SUBTRACT) std::cout << "  borrow = " << borrow << std::endl;
-        if (DEBUG_INT_SUBTRACT) std::cout << "  diff = " << diff << std::endl;
-        if (diff < 0) {
-            borrow = 1;
-            diff += BIN_LIMIT;
-        } else {
-            borrow = 0;
-        }
-        if (DEBUG_INT_SUBTRACT) std::cout << "  borrow = " << borrow << std::endl;
-        if (DEBUG_INT_SUBTRACT) std::cout << "  diff = " << diff << std::endl;
-        bins.at(i) = diff;
-    }
-    while (i < bins.size() && borrow != 0) {
-        diff = bins.at(i) - borrow;
-        if (diff < 0) {
-            borrow = 1;
-            diff += BIN_LIMIT;
-        } else {
-            borrow = 0;
-        }
-        bins.at(i) = diff;
-        ++i;
-    }
+    assert(cmp_bins(x) >= 0);
+    bins_sub(bins.data(), bins.data(), bins.size(), x.bins.data(), x.bins.size());
     cleanBins();
 }
 
+/* Int::times_power_ten - multiply by 10^power
+ *   A negative power divides, truncating towards zero.
+ */
 void Int::times_power_ten(int32_t power) {
-    int32_t pow = power;
-    if (pow > 0) {
-        for (int32_t i = 0; i < pow % BIN_WIDTH; ++i)
-            (*this) *= 10;
-        while (pow >= BIN_WIDTH) {
-            bins.push_front(0);
-            pow -= BIN_WIDTH;
+    bool was_negative = negative;
+    int32_t k;
+    if (power > 0) {
+        for (; power > 0; power -= k) {
+            k = (power < DEC_WIDTH) ? power : DEC_WIDTH;
+            multiply_by_int(*this, POW10[k], *this);
         }
-    } else if (pow < 0) {
-        pow = -pow;
-        while (pow >= BIN_WIDTH && !bins.empty()) {
-            bins.pop_front();
-            pow -= BIN_WIDTH;
-        }
-        if (bins.empty()) {
-            set_value(0);
-        } else {
-            for (int32_t i = 0; i < pow % BIN_WIDTH; ++i)
-                (*this) /= 10;
+    } else if (power < 0) {
+        for (power = -power; power > 0 && !equals_int32(0); power -= k) {
+            k = (power < DEC_WIDTH) ? power : DEC_WIDTH;
+            divide_by_int(*this, POW10[k], *this);
         }
     }
+    negative = was_negative && !equals_int32(0);
 }
 
-/* multiply_by_int - multiply an Int by an int
- *   This ignores signs. Pass in abs(y) and compute the sign afterwards.
- */
-void multiply_by_int(const Int& x, int32_t y, Int& result) {
-    int64_t prod;
-    result.set_value(0);
-    for (size_t i = 0; i < x.bins.size(); ++i) {
-        prod = ((int64_t) y) * ((int64_t) x.bins.at(i));
-        result += Int(prod, i);
+/* Int::bit_length - the number of bits in the magnitude, not counting leading zeros */
+size_t Int::bit_length() const {
+    size_t n = bins.size();
+    while (n > 0 && bins[n - 1] == 0)
+        --n;
+    if (n == 0)
+        return 0;
+    size_t bits = (n - 1) * BIN_WIDTH;
+    for (bin_t top = bins[n - 1]; top != 0; top >>= 1)
+        ++bits;
+    return bits;
+}
+
+/* Int::shift_left - multiply by 2^bits; whole bins are inserted, and the rest is a bin shift */
+void Int::shift_left(size_t bits) {
+    if (equals_int32(0))
+        return;
+    uint32_t r = bits % BIN_WIDTH;
+    if (r != 0) {
+        bin_t out = bins_lshift(bins.data(), bins.data(), bins.size(), r);
+        if (out != 0)
+            bins.push_back(out);
     }
+    shift(bits / BIN_WIDTH);
+}
+
+/* Int::shift_right - divide by 2^bits, truncating towards zero (the sign is kept) */
+void Int::shift_right(size_t bits) {
+    bins.shift_down(bits / BIN_WIDTH);
+    uint32_t r = bits % BIN_WIDTH;
+    if (bins.empty())
+        bins.push_back(0);
+    else if (r != 0)
+        bins_rshift(bins.data(), bins.data(), bins.size(), r);
+    cleanBins();
+    if (equals_int32(0))
+        negative = false;
+}
+
+/* multiply_by_int - multiply an Int by a single bin
+ *   This ignores signs (result is set positive). Pass in abs(y) and compute the sign afterwards.
+ *   This is safe to use when x and result are the same instance.
+ */
+void multiply_by_int(const Int& x, Int::bin_t y, Int& result) {
+    size_t n = x.bins.size();
+    result.bins.resize(n, 0);
+    Int::bin_t carry = bins_mul_1(result.bins.data(), x.bins.data(), n, y);
+    if (carry != 0)
+        result.bins.push_back(carry);
+    result.negative = false;
+    result.cleanBins();
 }
 
 /* multiply - multiply two Ints together
- *   This ignores signs and assumes x has at least as many bins as y
+ *   This ignores signs (result is set positive). result must not be the same instance as x or y.
+ *   The product is written straight into result's bins; bins_mul picks the algorithm.
  */
 void multiply(const Int& x, const Int& y, Int& result) {
-    Int b;
-    result.set_value(0);
-    for (size_t i = 0; i < y.bins.size(); ++i) {
-        multiply_by_int(x, y.bins.at(i), b);
-        result += Int(b, i);
-    }
+    assert(&result != &x && &result != &y);
+    result.bins.resize(x.bins.size() + y.bins.size());
+    bins_mul(result.bins.data(), x.bins.data(), x.bins.size(), y.bins.data(), y.bins.size());
+    result.negative = false;
+    result.cleanBins();
 }
 
-/* divide_by_int - divide and Int by an int
- *   This ignores signs. Pass in abs(y) and compute the sign aftwerwards.
+/* divide_by_int - divide an Int by a single bin, returning the remainder
+ *   This ignores signs (result is set positive). Pass in abs(y) and compute the sign aftwerwards.
+ *   This is safe to use when x and result are the same instance.
  */
-void divide_by_int(const Int& x, int32_t y, Int& result) {
-    result.bins.clear();
+Int::bin_t divide_by_int(const Int& x, Int::bin_t y, Int& result) {
     if (y == 0)
         throw divide_by_zero_error();
-    int64_t q, d;
-    int64_t r = 0;
-    for (size_t i = 0; i < x.bins.size(); ++i) {
-        d =  (r * Int::BIN_LIMIT) + x.get_bin_from_back(i);
-        q = d / y;
-        r = d % y;
-        result.bins.push_front(q);
-    }
-    if (result.bins.size() == 0)
-        result.bins.push_back(0);
-}
-
-/* iter_quotient - helper function for quotient_and_remainder
- *   This adds step to q and stops at the largest q such that x * q <= y.
- *   This assumes we'll have x and y so that 0 <= q < Int::BIN_LIMIT.
- *
- *   We know y >= x, and we want to find the quotient q and remainder r
- *   so that q * x + r = y. One way of doing so is to start with q = 0, and
- *   compute r = y - q*x for all q >= 0 until we find the an r less than x.
- *   This function allows us to iterate q by various step sizes repeatedly,
- *   so we can do essentially a binary search through possible values of q
- *   instead of a linear search.
- */
-void iter_quotient(const Int& y, const Int& x, int32_t& q, Int& r, int32_t step) {
-    int32_t b = q;
-    Int prod;
-    if (DEBUG_INT_DIVIDE) {
-        std::cout << "iter_quotient(y=" << y << ", x=" << x << ", q=" << q << ", r=" << r << ", step=" << step << ")" << std::endl;
-        std::cout << "  y.bins = " << y.bins << std::endl;
-        std::cout << "  x.bins = " << x.bins << std::endl;
-    }
-    do {
-        q = b;
-        b += step;
-        if (DEBUG_INT_DIVIDE) std::cout << "  b = " << b << std::endl;
-        multiply_by_int(x, b, prod);
-        if (DEBUG_INT_DIVIDE) std::cout << "  prod = " << prod << std::endl;
-        if (DEBUG_INT_DIVIDE) std::cout << "  prod.bins = " << prod.bins << std::endl;
-        r = y - prod;
-        if (DEBUG_INT_DIVIDE) std::cout << "  r = " << r << std::endl;
-    } while (!r.negative && x.cmp_bins(r) <= 0);
+    result.bins.resize(x.bins.size(), 0);
+    Int::bin_t r = bins_divrem_1(result.bins.data(), x.bins.data(), x.bins.size(), y);
+    result.negative = false;
+    result.cleanBins();
+    return r;
 }
 
 /* quotient_and_remainder - find q and r so that q * x + r = y.
  *   This assumes we'll have y and x so that x <= y < BIN_LIMIT * x,
- *   so we know after returning that q >= 1.
- *
- * -- Right now, iter_quotient (with step /= 2 before each call) checks
- *  (q + step) and (q + 2*step) which is unnecessary:
- *  We check:
- *      q = 50 000 000 and possibly q = 1 000 000 000
- *      q = 25 000 000 and possibly q = 50 000 000
- *      q = 12 500 000 and possibly q = 25 000 000
- *      ...
- * We're binary searching here over the values of q in [1, 1 000 000 000).
- * We stop when r = y - q*x is in [0, x).
- *      1. Check the midpoint q' = 50 000 000
- *          -- If the remainder r = y - q'*x >= 0, then q' <= q (branch right)
- *              We may have the correct value of q, or we may need to increase q to
- *              reduce r to be less than x.
- *          -- Otherwise, the remainder r = y - q'*x < 0, the q' > q (branch left)
- *              r is negative, so q is too big. We need to decrease q to get r >= 0.
+ *   so we know after returning that q >= 1 and fits in a single bin.
  */
-void quotient_and_remainder(const Int& y, const Int& x, int32_t& q, Int& r) {
+void quotient_and_remainder(const Int& y, const Int& x, Int::bin_t& q, Int& r) {
     if (DEBUG_INT_DIVIDE) std::cout << "quotient_and_remainder(" << y << ", " << x << ")" << std::endl;
-    if (DEBUG_INT_DIVIDE) std::cout << "  y.bins = " << y.bins << std::endl;
-    if (DEBUG_INT_DIVIDE) std::cout << "  x.bins = " << x.bins << std::endl;
     assert(!x.is_negative());
     assert(!y.is_negative());
     assert(x <= y && y < Int::BIN_LIMIT * x);
 
-    int32_t step = Int::BIN_LIMIT;
-    q = 0;
-    while (step > 1) {
-        step /= 2;
-        iter_quotient(y, x, q, r, step);
-    }
-    q += 1; // what is this for?
+    size_t yn = y.bins.size(), xn = x.bins.size();
+    Int::bin_t qbins[2] = { 0, 0 };     // y has at most one bin more than x
+    r.bins.resize(xn);
+    bins_divrem(qbins, r.bins.data(), y.bins.data(), yn, x.bins.data(), xn);
+    q = qbins[0];
+    r.negative = false;
+    r.cleanBins();
 }
 
 /* Int::divide - do an in-place division of two Ints
  *   This handles the sign, and throws a divide_by_zero_error when x is zero.
+ *   The quotient truncates toward zero. Single bin divisors take the short
+ *   division in divide_by_int; anything longer is Knuth's long division (bins_divrem).
  */
 void Int::divide(const Int& x) {
+    int64_t a, b;
+    if (small(a) && x.small(b) && b != 0) {
+        set_small(a / b);
+        return;
+    }
     if (x.equals_int32(0)) {
         throw divide_by_zero_error();
     } else if (cmp_bins(x) < 0) {  // division by a larger number truncates
@@ -608,92 +776,126 @@ void Int::divide(const Int& x) {
         return;
     }
 
-
-//    bool result_is_neg = (negative != x.negative);
-    const Int& x_norm = (x.negative) ? -x : x;
-
-
-    Int r, current;
-    int32_t q;
-    for (int32_t i = ((int32_t) bins.size()) - 1; i >= 0; --i) {
-        if (DEBUG_INT_DIVIDE) std::cout << "i = " << i << "(divide)" << std::endl
-                  << "  *this = " << *this << std::endl
-                  << "  bins.size() = " << bins.size() << std::endl
-                  << "  bins = " << bins << std::endl
-                  << "  x_norm = " << x_norm << std::endl;
-        assert(current.bins.size() > 0);
-        assert(0 <= i && ((size_t) i) < bins.size());
-        current.bins.at(0) = bins.at(i);
-        if (DEBUG_INT_DIVIDE) std::cout << "  current = " << current << std::endl;
-        if (x_norm.cmp_bins(current) <= 0) {    // if x_norm divides current (with some remainder)
-            quotient_and_remainder(current, x_norm, q, r);
-            if (DEBUG_INT_DIVIDE) std::cout << "  setting index " << i << " = " << q << std::endl;
-            assert(q != 0);
-            bins.at(i) = q;
-            current = r;
-        } else {
-            if (DEBUG_INT_DIVIDE) std::cout << "  setting index " << i << " = ZERO" << std::endl;
-            bins.at(i) = 0;
-            cleanBins();
-        }
-        current.shift(1);
-        current.cleanBins();
+    bool result_is_neg = (negative != x.negative);
+    if (x.bins.size() == 1) {
+        divide_by_int(*this, x.bins[0], *this);
+    } else {
+        Int q;
+        q.bins.resize(bins.size() - x.bins.size() + 1);
+        bins_divrem(q.bins.data(), NULL, bins.data(), bins.size(), x.bins.data(), x.bins.size());
+        swap(bins, q.bins);
+        cleanBins();
     }
-    negative = (negative != x.negative);
+    negative = result_is_neg && !equals_int32(0);
 }
 
-/* modulo - compute the modulus of two Ints according to the "floored division"
+/* divmod - floored division: q = floor(x / y) and r = x - q * y
  *   (see: http://en.wikipedia.org/wiki/Modulo_operation)
+ *   The remainder is zero or has the sign of y. Both come out of a single long division.
+ *   q and r must be different instances, but either may be the same instance as x or y.
+ *   This throws a divide_by_zero_error when y is zero.
  */
-void modulo(const Int& x, const Int& y, Int& result) {
-    Int a(x);
-    Int b(y);
-    if (a.negative)
-        a.negate();
-    if (b.negative)
-        b.negate();
+void divmod(const Int& x, const Int& y, Int& q, Int& r) {
+    assert(&q != &r);
+    if (y.equals_int32(0))
+        throw divide_by_zero_error();
 
-    if (DEBUG_INT_MODULO) {
-        std::cout << "Int::modulo(x, y)" << std::endl
-                  << "  a = " << a << std::endl
-                  << "  b = " << b << std::endl;
-    }
-    Int q = a / b;
-    if (DEBUG_INT_MODULO) std::cout << "  q = " << q << std::endl;
-    result = a - q * b;
-    if (DEBUG_INT_MODULO) std::cout << "  result = " << result << std::endl;
-    if (result.equals_int32(0))
+    int64_t a, b;
+    if (x.small(a) && y.small(b)) {
+        int64_t qv = a / b, rv = a % b;
+        if (rv != 0 && (rv < 0) != (b < 0)) {
+            --qv;
+            rv += b;
+        }
+        q.set_small(qv);
+        r.set_small(rv);
         return;
-    if (x.negative && y.negative)
-        result.negate();
-    else if (!x.negative && y.negative)
-        result += y;
-    else if (x.negative && !y.negative)
-        result = y - result;
-}
-
-/* exponentiate - compute x raise to the y power
- *   This is recursive. To compute x^y:
- *      -- If y is odd, return x * x^(y-1)
- *      -- If y is even, return x^y = x^(y/2) * x^(y/2)
- *      -- If y is 0 or 1, return 1 or x respectively.
- *   The recursion therefore terminates after about log_2(y) calls.
- * TODO: Do something when y < 0. Either throw an exception on negative exponents, or
- *   return 1/x^(abs(y)) (which is zero for any x > 1 and abs(y)) > 1)
+    }
+
+    Int quot, rem;
+    size_t xn = x.bins.size(), yn = y.bins.size();
+    if (x.cmp_bins(y) < 0) {            // the quotient is zero
+        rem.bins = x.bins;
+    } else if (yn == 1) {
+        rem.bins[0] = divide_by_int(x, y.bins[0], quot);
+    } else {
+        quot.bins.resize(xn - yn + 1);
+        rem.bins.resize(yn);
+        bins_divrem(quot.bins.data(), rem.bins.data(), x.bins.data(), xn, y.bins.data(), yn);
+        quot.cleanBins();
+        rem.cleanBins();
+    }
+    if (DEBUG_INT_MODULO) {
+        std::cout << "divmod(x=" << x << ", y=" << y << ")" << std::endl
+                  << "  |q| = " << quot << std::endl
+                  << "  |r| = " << rem << std::endl;
+    }
+
+    // the division was on magnitudes, so it truncated toward zero; floor it instead
+    if (x.negative != y.negative && !rem.equals_int32(0)) {
+        quot.add_bin(1);
+        Int absy(y);
+        absy.negative = false;
+        absy.subtract(rem);
+        swap(rem, absy);
+    }
+    quot.negative = (x.negative != y.negative) && !quot.equals_int32(0);
+    rem.negative = y.negative && !rem.equals_int32(0);
+    swap(q, quot);
+    swap(r, rem);
+}
+
+/* PlainPowers - the arithmetic for exponentiate's sliding window (see SlidingWindow.hpp)
+ *   These are on magnitudes; two buffers are swapped so squaring doesn't allocate.
+ */
+class PlainPowers {
+  public:
+    explicit PlainPowers(const Int& x) : base(x) { base.negative = false; }
+
+    void odd_powers(size_t count) {
+        odd.resize(count);
+        odd[0] = base;
+        if (count > 1) {
+            Int sq;
+            multiply(base, base, sq);
+            for (size_t j = 1; j < count; ++j)
+                multiply(odd[j - 1], sq, odd[j]);
+        }
+    }
+    inline void start(size_t j) { acc = odd[j]; }
+    inline void square() { multiply(acc, acc, tmp); swap(acc, tmp); }
+    inline void multiply_by(size_t j) { multiply(acc, odd[j], tmp); swap(acc, tmp); }
+
+    Int acc;
+  private:
+    Int base, tmp;
+    std::vector<Int> odd;
+};
+
+/* exponentiate - compute x raised to the y power
+ *   This is a left-to-right sliding window over the bits of y (see SlidingWindow.hpp).
+ *   Squaring goes through multiply() with the same Int twice, which bins_mul spots
+ *   and does with about half the bin products.
+ *
+ *   A negative y gives 1 / x^|y|, truncated like division: zero unless x is 1 or -1,
+ *   and a divide_by_zero_error when x is zero.
  */
 void exponentiate(const Int& x, const Int& y, Int& result) {
-    if (y.equals_int32(0)) {
+    if (y.negative) {
+        if (x.equals_int32(0))
+            throw divide_by_zero_error();
+        else if (x.cmp_bins(Int(1)) != 0)
+            result.set_value(0);
+        else
+            result.set_value((x.negative && y.is_odd()) ? -1 : 1);
+        return;
+    } else if (y.equals_int32(0)) {
         result.set_value(1);
-    } else if (y.equals_int32(1)) {
-        result = x;
-    } else if (y.is_odd()) {
-        Int a;
-        exponentiate(x, y - Int(1), a);
-        result = x * a;
-    } else {
-        Int half_y;
-        divide_by_int(y, 2, half_y);
-        exponentiate(x, half_y, result);
-        result = result * result;
+        return;
     }
+
+    PlainPowers p(x);
+    sliding_window_power(y.bins.data(), y.bins.size(), p);
+    p.acc.negative = x.negative && y.is_odd() && !p.acc.equals_int32(0);
+    swap(result, p.acc);
 }
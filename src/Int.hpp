@@ -6,53 +6,101 @@
 #include <sstream>
 #include <limits>
 #include <string>
-#include <deque>
+#include <vector>
 #include <cassert>
+#include <utility>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
 #include "common.hpp"
+#include "BinStorage.hpp"
 
 /* Int - a (virtually) arbitrary precision integer
  *
  * All the arithmetic operators are overloaded. Division truncates the fractional part.
  * The modulo operator works according to the "floored division" method
  * (http://en.wikipedia.org/wiki/Modulo_operation) which may be different than 
- * modulo on ints in C++ for negative numbers.
+ * modulo on ints in C++ for negative numbers. divmod() gives the floored quotient
+ * and the remainder together.
  *
  * === Implementation notes ===
- *  Conceptually, this is implemented as a list of bins where each bin contains 
- *  some number of decimal digits (Int::BIN_WIDTH), and arithmetic is done bin-by-bin.
- *  Concretely, each bin is a (positive) int with value at most 10^BIN_WIDTH (== Int::BIN_LIMIT).
- *  A 32-bit int can store at most 9 decimal digits, so BIN_WIDTH is fixed to 9.
- *  Bins are ordered from least-significant first (index 0) to most-significant.
- *  
- *  This uses 64-bit ints to temporarily store the product of two 32-bit ints. If there
- *  is at most a 32-bit int available, then the code would need to be changed to use 
- *  16 bits per bin (4 decimal digits) so that the product of two bins does not 
- *  overflow a 32-bit int.
- *  common.hpp tries to define int32_t and int64_t as 32-bit and 64-bit signed integers.
+ *  This is implemented as a list of bins, where each bin is one base-2^32 digit
+ *  (Int::BIN_WIDTH bits, so each bin is less than Int::BIN_LIMIT), and arithmetic is
+ *  done bin-by-bin. Bins are ordered from least-significant first (index 0) to
+ *  most-significant. The sign is stored separately, so bins hold the magnitude.
+ *  The bins are stored contiguously (see BinStorage.hpp). The first INLINE_BINS bins
+ *  live inside the Int itself, so numbers below 2^128 never allocate. Moving an Int
+ *  hands over its heap bins, and the operators taking an rvalue build their result in
+ *  that operand, so an expression like a * b + c * d copies no bins.
+ *
+ *  Values below 2^63 in size (at most two bins) also take a fast path in +, -, *, /, %
+ *  and the comparisons: the operands are read out as int64_t, the arithmetic is done
+ *  with overflow checks (common.hpp), and only on overflow does it fall back to the
+ *  bins. The result is written straight back into the inline bins.
+ *
+ *  Carries and borrows are the high half of a 64-bit sum or product, so no
+ *  division is needed in add, subtract or multiply. Decimal digits only matter
+ *  in print() and read(), which convert DEC_WIDTH digits (one DEC_LIMIT chunk) at a time
+ *  for small numbers, and split huge ones at powers of ten (from RADIX_THRESHOLD bins).
+ *
+ *  This uses 64-bit ints to temporarily store the product of two 32-bit bins.
+ *  common.hpp tries to define (u)int32_t and (u)int64_t as 32-bit and 64-bit integers.
  */
 class Int {
   public:
-    static const int32_t BIN_WIDTH = 9;
-    static const int32_t BIN_LIMIT = 1000000000;
+    typedef uint32_t bin_t;
+    static const int32_t BIN_WIDTH = 32;            /* bits per bin */
+    static const int64_t BIN_LIMIT = 4294967296LL;  /* 2^BIN_WIDTH */
+    static const int32_t DEC_WIDTH = 9;             /* decimal digits per chunk in print/read */
+    static const int32_t DEC_LIMIT = 1000000000;    /* 10^DEC_WIDTH */
+    static const size_t INLINE_BINS = 4;
+    static size_t RADIX_THRESHOLD;   /* bins at which decimal conversion splits recursively; tunable */
+    typedef BinStorage<bin_t, INLINE_BINS> bins_t;
 
     Int();
-    Int(const Int& x, size_t shift = 0);    /* shift is the number of bins */
+    Int(const Int& x) : bins(x.bins), negative(x.negative) { }
+    Int(Int&& x) : bins(std::move(x.bins)), negative(x.negative) { x.set_value(0); }
+    Int(const Int& x, size_t shift);        /* shift is the number of bins */
     Int(int64_t x, size_t shift = 0);
     explicit Int(const std::string& x);
 
+    inline Int& operator=(const Int& x) {
+        bins = x.bins;
+        negative = x.negative;
+        return *this;
+    }
+    /* x is left as zero */
+    inline Int& operator=(Int&& x) {
+        if (this != &x) {
+            bins = std::move(x.bins);
+            negative = x.negative;
+            x.set_value(0);
+        }
+        return *this;
+    }
+
     friend std::ostream& operator<<(std::ostream& o, const Int& x);
     friend std::istream& operator>>(std::istream& i, Int& x);
     std::ostream& print(std::ostream& out) const;
     std::istream& read(std::istream& in);
-    friend std::ostream& operator<<(std::ostream& o, const std::deque<int32_t>& deque);
+    std::string to_string() const;
+    bool parse(const char* first, const char* last);    /* no exceptions; false on bad input */
+    inline bool parse(const char* s, size_t n) { return parse(s, s + n); }
+#if __cplusplus >= 201703L
+    inline bool parse(std::string_view s) { return parse(s.data(), s.data() + s.size()); }
+#endif
+    static Int from_string(const std::string& x);   /* same as Int(x) */
+    friend std::ostream& operator<<(std::ostream& o, const bins_t& bins);
 
     void set_value(int32_t x);
     bool equals_int32(int32_t x) const;
     int32_t cmp(const Int& y) const;
     void times_power_ten(int32_t power);
+    size_t bit_length() const;          /* bits in |*this|; zero for zero */
+    void shift_left(size_t bits);       /* multiply by 2^bits */
+    void shift_right(size_t bits);      /* divide by 2^bits, truncating towards zero */
 
-    // inline bool is_odd() const { return bins[0] % 2 == 1; }
-    inline bool is_odd() const { return bins.at(0) % 2 == 1; }
+    inline bool is_odd() const { return (bins[0] & 1) != 0; }
     inline bool is_negative() const { return negative; }
     inline void negate() { negative = (equals_int32(0) ? false : !negative); }
 
@@ -64,6 +112,39 @@ class Int {
     friend Int operator % (const Int& x, const Int& y);
     friend Int operator ^ (const Int& x, const Int& y);
 
+    /* These reuse the bins of an expiring operand for the result */
+    friend Int operator - (Int&& x);
+    friend Int operator + (Int&& x, const Int& y);
+    friend Int operator + (const Int& x, Int&& y);
+    friend Int operator + (Int&& x, Int&& y);
+    friend Int operator - (Int&& x, const Int& y);
+    friend Int operator - (const Int& x, Int&& y);
+    friend Int operator - (Int&& x, Int&& y);
+    friend Int operator / (Int&& x, const Int& y);
+    friend Int operator % (Int&& x, const Int& y);
+
+    /* q = floor(x / y) and r = x - q * y, from one division (r has the sign of y) */
+    friend void divmod(const Int& x, const Int& y, Int& q, Int& r);
+
+    /* base^exp mod mod, with every intermediate below mod (see Modular.cpp) */
+    friend Int powmod(const Int& base, const Int& exp, const Int& mod);
+
+    /* the greatest common divisor, never negative (Lehmer's algorithm; see Gcd.cpp) */
+    friend Int gcd(const Int& x, const Int& y);
+    /* g = gcd(x, y) = s * x + t * y, and the inverse of a mod m (see Gcd.cpp) */
+    friend void xgcd(const Int& x, const Int& y, Int& g, Int& s, Int& t);
+    friend Int invmod(const Int& a, const Int& m);
+
+    /* whether n is prime: exact below 2^64, and the Baillie-PSW test above (see Primes.cpp) */
+    friend bool is_prime(const Int& n);
+
+    /* Exact roots, rounded down (towards zero for odd roots of negatives; see Roots.cpp) */
+    friend Int iroot(const Int& x, uint32_t n);
+    friend Int isqrt(const Int& x);
+    /* true if x = base^exp for some exp > 1, with the largest such exp */
+    friend bool is_perfect_power(const Int& x, Int& base, uint32_t& exp);
+    friend bool is_perfect_power(const Int& x);
+
     void operator += (const Int& other);
     void operator -= (const Int& other);
     void operator *= (const Int& other);
@@ -71,33 +152,54 @@ class Int {
     void operator %= (const Int& other);
     void operator ^= (const Int& other);
 
+    /* *this += a * b (or -= when subtract is set), without forming a * b on its own.
+     * IntExpr.hpp builds on this. */
+    void add_product(const Int& a, const Int& b, bool subtract = false);
+
     inline bool operator < (const Int& other) const { return cmp(other) < 0; }
     inline bool operator > (const Int& other) const { return cmp(other) > 0; }
     inline bool operator <= (const Int& other) const { return cmp(other) <= 0; }
     inline bool operator >= (const Int& other) const { return cmp(other) >= 0; }
     inline bool operator != (const Int& other) const { return cmp(other) != 0; }
     inline bool operator == (const Int& other) const { return cmp(other) == 0; }
+
+    friend void swap(Int& a, Int& b) {
+        using std::swap;
+        swap(a.bins, b.bins);
+        swap(a.negative, b.negative);
+    }
   private:
-    std::deque<int32_t> bins;
+    bins_t bins;
     bool negative;
 
     int32_t cmp_bins(const Int& x) const;
 
-    inline void shift(size_t amount) {
-        for (size_t i = 0; i < amount; ++i)
-            bins.push_front(0);
+    /* small - *this as an int64_t in v, if it fits (|*this| < 2^63 in at most two bins) */
+    inline bool small(int64_t& v) const {
+        size_t n = bins.size();
+        if (n > 2)
+            return false;
+        uint64_t m = bins[0] | ((n == 2) ? (uint64_t) bins[1] << BIN_WIDTH : 0);
+        if (m >> (2 * BIN_WIDTH - 1))
+            return false;
+        v = negative ? -(int64_t) m : (int64_t) m;
+        return true;
     }
-//    inline void set_bin_from_back(int32_t i, int32_t val) { bins[bins.size() - 1 - i] = val; }
-    inline void set_bin_from_back(int32_t i, int32_t val) {
-//        std::cout << "set_bin_from_back" << std::endl;
-//        std::cout << "  bins.size() = " << bins.size() << std::endl;
-//        std::cout << "  1 + i = " << (1 + i) << std::endl;
-//        std::cout << "  bins.size() - (1+i) = " << (bins.size() - 1 - i) << std::endl;
-//        bins.at(bins.size() - 1 - i) = val;
-        bins[bins.size() - 1 - i] = val;
+    /* set_small - set *this to v */
+    inline void set_small(int64_t v) {
+        uint64_t m = (v < 0) ? 0 - (uint64_t) v : (uint64_t) v;
+        bool high = (m >> BIN_WIDTH) != 0;
+        bins.resize(high ? 2 : 1);
+        bins[0] = (bin_t) m;
+        if (high)
+            bins[1] = (bin_t) (m >> BIN_WIDTH);
+        negative = (v < 0);
     }
-//    inline int32_t get_bin_from_back(int32_t i) const { return bins[bins.size() - 1 - i]; }
-    inline int32_t get_bin_from_back(int32_t i) const { return bins.at(bins.size() - 1 - i); }
+
+    inline void shift(size_t amount) { bins.shift_up(amount); }
+//    inline void set_bin_from_back(int32_t i, int32_t val) { bins[bins.size() - 1 - i] = val; }
+    inline void set_bin_from_back(int32_t i, bin_t val) { bins[bins.size() - 1 - i] = val; }
+    inline bin_t get_bin_from_back(int32_t i) const { return bins[bins.size() - 1 - i]; }
 
     /*
      * A number is stored in "reverse" order.
@@ -115,24 +217,43 @@ class Int {
      */
     void cleanBins();
 
+    /* Decimal conversion helpers for print() and read() */
+    class DigitWriter;
+    static const Int& dec_power(size_t k);
+    static void write_digits(const Int& x, size_t width, DigitWriter& out);
+    void read_digits(const char* digits, size_t n);
+
     /* All the following functions are helpers to the operator overloads.
      * Some aren't member functions because they have awkward in-place versions.
      * They make various assumptions about inputs (add/subtract require positives)
      * Check the comments at the functions' definition for more.
      */
     void add(const Int& x);
+    void add_bin(bin_t x);
+    void add_signed(const Int& x, bool x_negative);
     void subtract(const Int& x);
     void divide(const Int& x);
     friend void multiply(const Int& x, const Int& y, Int& result);
-    friend void multiply_by_int(const Int& x, int32_t y, Int& result);
-    friend void divide_by_int(const Int& x, int32_t y, Int& result);
-    friend void quotient_and_remainder(const Int& y, const Int& x, int32_t& q, Int& r);
-    friend void iter_quotient(const Int& y, const Int& x, int32_t& q, Int& r, int32_t step);
-    friend void modulo(const Int& x, const Int& y, Int& result);
+    friend void multiply_by_int(const Int& x, bin_t y, Int& result);
+    friend bin_t divide_by_int(const Int& x, bin_t y, Int& result);
+    friend void quotient_and_remainder(const Int& y, const Int& x, bin_t& q, Int& r);
     friend void exponentiate(const Int& x, const Int& exp, Int& result);
+    friend void bezout(const Int& x, const Int& y, Int& g, Int& s);
+    friend class PlainPowers;
+    friend class DividedPowers;
+    friend class ModContext;
+    friend class Factorizer;
 };
 
+/* Products of many factors, multiplied out as a balanced tree (see Combinatorics.cpp).
+ * With parallel set, big subtrees run on the PARALLEL_THREADS pool (Parallel.hpp). */
+Int product(const std::vector<Int>& factors, bool parallel = false);
+Int factorial(uint32_t n);
+Int binomial(uint32_t n, uint32_t k);                   /* zero when k > n */
+Int multinomial(const std::vector<uint32_t>& parts);    /* (k_1 + ... + k_m)! / (k_1! ... k_m!) */
 
-
+/* Fused r += a * b and r -= a * b, for generic code such as Mat<Int> */
+inline void add_product(Int& r, const Int& a, const Int& b) { r.add_product(a, b); }
+inline void sub_product(Int& r, const Int& a, const Int& b) { r.add_product(a, b, true); }
 
 #endif
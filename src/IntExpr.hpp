@@ -0,0 +1,157 @@
+#ifndef _INT_EXPR_HPP_
+#define _INT_EXPR_HPP_
+#include "Int.hpp"
+
+/* IntExpr - opt-in expression templates for fused Int arithmetic
+ *   prod(a, b) stands for the product a * b without computing it. Sums and
+ *   differences of products (and plain Ints) build up an expression, which is
+ *   only evaluated when it is converted to an Int or added to one:
+ *
+ *      Int r = prod(a, b) + prod(c, d);    // one result buffer, no product temporaries
+ *      r -= prod(val, x);                  // accumulated straight into r
+ *
+ *   Each product is accumulated into the destination with Int::add_product, so
+ *   a * b + c * d does one multiplication into the result and adds the other
+ *   into it as it is formed.
+ *
+ *   An expression holds references to its operands, which must outlive it, so
+ *   don't keep one around (e.g. in an auto variable) past the end of the statement.
+ */
+template <typename E>
+class IntExpr {
+  public:
+    inline const E& self() const { return static_cast<const E&>(*this); }
+
+    /* evaluate into a new Int */
+    operator Int() const {
+        Int r;
+        self().accumulate(r, false);
+        return r;
+    }
+};
+
+/* IntProduct - a * b */
+class IntProduct : public IntExpr<IntProduct> {
+  public:
+    IntProduct(const Int& x, const Int& y) : a(x), b(y) { }
+
+    inline void accumulate(Int& r, bool subtract) const { r.add_product(a, b, subtract); }
+    inline bool refers_to(const Int& r) const { return &a == &r || &b == &r; }
+  private:
+    const Int& a;
+    const Int& b;
+};
+
+/* IntTerm - a plain Int in an expression */
+class IntTerm : public IntExpr<IntTerm> {
+  public:
+    explicit IntTerm(const Int& x) : a(x) { }
+
+    inline void accumulate(Int& r, bool subtract) const {
+        if (subtract)
+            r -= a;
+        else
+            r += a;
+    }
+    inline bool refers_to(const Int& r) const { return &a == &r; }
+  private:
+    const Int& a;
+};
+
+/* IntSum - x + y, or x - y when subtract is set */
+template <typename E1, typename E2>
+class IntSum : public IntExpr<IntSum<E1, E2> > {
+  public:
+    IntSum(const E1& a, const E2& b, bool sub) : x(a), y(b), subtract(sub) { }
+
+    inline void accumulate(Int& r, bool negate) const {
+        x.accumulate(r, negate);
+        y.accumulate(r, negate != subtract);
+    }
+    inline bool refers_to(const Int& r) const { return x.refers_to(r) || y.refers_to(r); }
+  private:
+    const E1 x;     // the leaves are small, so sub-expressions are held by value
+    const E2 y;
+    bool subtract;
+};
+
+inline IntProduct prod(const Int& a, const Int& b) {
+    return IntProduct(a, b);
+}
+
+template <typename E1, typename E2>
+inline IntSum<E1, E2> operator+(const IntExpr<E1>& x, const IntExpr<E2>& y) {
+    return IntSum<E1, E2>(x.self(), y.self(), false);
+}
+
+template <typename E1, typename E2>
+inline IntSum<E1, E2> operator-(const IntExpr<E1>& x, const IntExpr<E2>& y) {
+    return IntSum<E1, E2>(x.self(), y.self(), true);
+}
+
+template <typename E>
+inline IntSum<IntTerm, E> operator+(const Int& x, const IntExpr<E>& y) {
+    return IntSum<IntTerm, E>(IntTerm(x), y.self(), false);
+}
+
+template <typename E>
+inline IntSum<IntTerm, E> operator-(const Int& x, const IntExpr<E>& y) {
+    return IntSum<IntTerm, E>(IntTerm(x), y.self(), true);
+}
+
+template <typename E>
+inline IntSum<E, IntTerm> operator+(const IntExpr<E>& x, const Int& y) {
+    return IntSum<E, IntTerm>(x.self(), IntTerm(y), false);
+}
+
+template <typename E>
+inline IntSum<E, IntTerm> operator-(const IntExpr<E>& x, const Int& y) {
+    return IntSum<E, IntTerm>(x.self(), IntTerm(y), true);
+}
+
+/* A temporary Int takes the expression into its own bins. These are exact matches,
+ * so they win over both the forms above and Int's own rvalue operators (which would
+ * otherwise tie, through the conversion of the expression to Int). */
+template <typename E>
+inline Int operator+(Int&& x, const IntExpr<E>& y) {
+    x += y;
+    return std::move(x);
+}
+
+template <typename E>
+inline Int operator-(Int&& x, const IntExpr<E>& y) {
+    x -= y;
+    return std::move(x);
+}
+
+template <typename E>
+inline Int operator+(const IntExpr<E>& x, Int&& y) {
+    y += x;
+    return std::move(y);
+}
+
+template <typename E>
+inline Int operator-(const IntExpr<E>& x, Int&& y) {
+    y.negate();
+    y += x;
+    return std::move(y);
+}
+
+/* r += x and r -= x accumulate into r, unless x uses r itself */
+template <typename E>
+inline void operator+=(Int& r, const IntExpr<E>& x) {
+    if (x.self().refers_to(r))
+        r += Int(x);
+    else
+        x.self().accumulate(r, false);
+}
+
+template <typename E>
+inline void operator-=(Int& r, const IntExpr<E>& x) {
+    if (x.self().refers_to(r))
+        r -= Int(x);
+    else
+        x.self().accumulate(r, true);
+}
+
+#endif
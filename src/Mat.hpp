@@ -93,6 +93,19 @@ class Mat {
     }
 };
 
+/* add_product and sub_product - r += a * b and r -= a * b
+ *   Types that can do these without a temporary product (like Int) overload them.
+ */
+template <typename T>
+inline void add_product(T& r, const T& a, const T& b) {
+    r += a * b;
+}
+
+template <typename T>
+inline void sub_product(T& r, const T& a, const T& b) {
+    r -= a * b;
+}
+
 template <typename T>
 std::ostream& operator<<(std::ostream& out, Mat<T> m) {
     for (size_t i = 0; i < m.numRows(); ++i) {
@@ -243,7 +256,7 @@ Mat<T> operator*(const Mat<T>& a, const Mat<T>& b) {
     for (size_t i = 0; i < a.numRows(); ++i)
         for (size_t k = 0; k < a.numCols(); ++k)
             for (size_t j = 0; j < b.numCols(); ++j)
-                r(i, j) += a(i,k) * b(k, j);
+                add_product(r(i, j), a.entry(i, k), b.entry(k, j));
     return r;
 }
 
@@ -256,7 +269,7 @@ void operator*=(Mat<T>& a, const Mat<T>& b) {
     for (size_t i = 0; i < a.numRows(); ++i)
         for (size_t k = 0; k < a.numCols(); ++k)
             for (size_t j = 0; j < b.numCols(); ++j)
-                r(i, j) += a(i,k) * b(k, j);
+                add_product(r(i, j), a.entry(i, k), b.entry(k, j));
     swap(a, r);
 }
 
@@ -445,7 +458,7 @@ void Mat<T>::inplace_rref() {
             if (i != r) {
                 val = entry(i, pivot);
                 for (size_t j = 0; j < cols; ++j)
-                    entry(i, j) -= val * entry(r, j);
+                    sub_product(entry(i, j), val, entry(r, j));
             }
         }
         pivot++; 
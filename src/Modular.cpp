@@ -0,0 +1,267 @@
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include "Modular.hpp"
+#include "BinOps.hpp"
+#include "SlidingWindow.hpp"
+
+/* Modular.cpp - modular exponentiation and reduction
+ *
+ * powmod() keeps every intermediate below the modulus, so a^e mod m costs about
+ * log2(e) products of the modulus' size however big a^e would be.
+ *
+ * For an odd modulus m of n bins the products are reduced by Montgomery's method
+ * (P. Montgomery, "Modular Multiplication Without Trial Division", 1985). Numbers
+ * are kept as x * R mod m, with R = 2^(32n). The product of two such numbers is
+ * divided by R exactly by adding a multiple of m that clears the low bins, one bin
+ * at a time, which costs about one n x n product and needs no division at all.
+ * An even modulus has no inverse mod R, so each product is reduced by long division.
+ *
+ * ModContext (see Modular.hpp) reduces by Barrett's method instead, which works for
+ * any modulus and on numbers in the ordinary form.
+ */
+
+/* MontgomeryPowers - the arithmetic for powmod's sliding window, mod an odd m */
+class MontgomeryPowers {
+  public:
+    MontgomeryPowers(const bin_t* mod, size_t mn, const bin_t* base, size_t bn)
+        : m(mod, mod + mn), n(mn), t(2 * mn + 1), x(mn), acc(mn) {
+        bin_t inv = m[0];           // Newton's iteration: each step doubles the correct low bits
+        for (int i = 0; i < 4; ++i)
+            inv *= 2 - m[0] * inv;
+        minv = -inv;
+
+        // R^2 mod m, for moving numbers into Montgomery form
+        std::vector<bin_t> r2_num(2 * n + 1, 0);
+        r2_num[2 * n] = 1;
+        r2.resize(n);
+        bins_divrem(NULL, r2.data(), r2_num.data(), 2 * n + 1, m.data(), n);
+
+        std::copy(base, base + bn, x.begin());
+        mul(x.data(), x.data(), r2.data());
+    }
+
+    void odd_powers(size_t count) {
+        odd.resize(count * n);
+        std::copy(x.begin(), x.end(), odd.begin());
+        if (count > 1) {
+            std::vector<bin_t> sq(n);
+            mul(sq.data(), x.data(), x.data());
+            for (size_t j = 1; j < count; ++j)
+                mul(&odd[j * n], &odd[(j - 1) * n], sq.data());
+        }
+    }
+    inline void start(size_t j) { std::copy(&odd[j * n], &odd[j * n] + n, acc.begin()); }
+    inline void square() { mul(acc.data(), acc.data(), acc.data()); }
+    inline void multiply_by(size_t j) { mul(acc.data(), acc.data(), &odd[j * n]); }
+
+    /* the result, out of Montgomery form */
+    void result(bin_t* r) {
+        std::fill(t.begin(), t.end(), 0);
+        std::copy(acc.begin(), acc.end(), t.begin());
+        redc(r);
+    }
+  private:
+    std::vector<bin_t> m;
+    size_t n;
+    bin_t minv;                 // -m^-1 mod 2^32
+    std::vector<bin_t> r2;
+    std::vector<bin_t> t;       // 2n + 1 bins of scratch for products
+    std::vector<bin_t> x;       // the base, in Montgomery form
+    std::vector<bin_t> acc;
+    std::vector<bin_t> odd;     // the odd powers, n bins each
+
+    /* r = a * b / R mod m, for a, b < m; r may be a or b */
+    inline void mul(bin_t* r, const bin_t* a, const bin_t* b) {
+        bins_mul(t.data(), a, n, b, n);
+        t[2 * n] = 0;
+        redc(r);
+    }
+
+    /* redc - r = t / R mod m, for t < m * R
+     *   Adding u * m * 2^(32i), with u = t[i] * minv, clears bin i of t. After n
+     *   steps, t / R is exact and below 2m, so one subtraction finishes it.
+     */
+    void redc(bin_t* r) {
+        for (size_t i = 0; i < n; ++i) {
+            bin_t c = bins_addmul_1(&t[i], m.data(), n, t[i] * minv);
+            bins_add_1(&t[i + n], &t[i + n], n + 1 - i, c);
+        }
+        if (t[2 * n] != 0 || bins_cmp(&t[n], m.data(), n) >= 0)
+            bins_sub(r, &t[n], n, m.data(), n);
+        else
+            std::copy(&t[n], &t[2 * n], r);
+    }
+};
+
+/* DividedPowers - the arithmetic for powmod's sliding window, mod an even m */
+class DividedPowers {
+  public:
+    DividedPowers(const Int& mod, const Int& base) : m(mod), x(base) { }
+
+    void odd_powers(size_t count) {
+        odd.resize(count);
+        odd[0] = x;
+        if (count > 1) {
+            Int sq;
+            multiply(x, x, sq);
+            reduce(sq);
+            for (size_t j = 1; j < count; ++j) {
+                multiply(odd[j - 1], sq, odd[j]);
+                reduce(odd[j]);
+            }
+        }
+    }
+    inline void start(size_t j) { acc = odd[j]; }
+    inline void square() { multiply(acc, acc, tmp); reduce(tmp); swap(acc, tmp); }
+    inline void multiply_by(size_t j) { multiply(acc, odd[j], tmp); reduce(tmp); swap(acc, tmp); }
+
+    Int acc;
+  private:
+    const Int& m;
+    Int x, tmp;
+    std::vector<Int> odd;
+
+    /* y = y mod m, for 0 <= y */
+    void reduce(Int& y) {
+        size_t yn = y.bins.size(), mn = m.bins.size();
+        if (yn < mn)
+            return;
+        Int r;
+        r.bins.resize(mn);
+        bins_divrem(NULL, r.bins.data(), y.bins.data(), yn, m.bins.data(), mn);
+        r.cleanBins();
+        swap(y, r);
+    }
+};
+
+/* powmod - base^exp mod mod, without ever forming base^exp
+ *   As with %, the result is zero or has the sign of mod (so it is in [0, mod) for
+ *   a positive mod). This throws a divide_by_zero_error when mod is zero, and a
+ *   domain_error when exp is negative.
+ */
+Int powmod(const Int& base, const Int& exp, const Int& mod) {
+    if (mod.equals_int32(0))
+        throw divide_by_zero_error();
+    if (exp.is_negative())
+        throw std::domain_error("powmod: negative exponent");
+
+    Int m(mod), b, q;
+    m.negative = false;
+    m.cleanBins();
+    divmod(base, m, q, b);          // 0 <= b < m
+    Int r;
+    if (m.equals_int32(1)) {
+        r.set_value(0);
+    } else if (exp.equals_int32(0)) {
+        r.set_value(1);
+    } else if (m.is_odd()) {
+        size_t n = m.bins.size();
+        MontgomeryPowers p(m.bins.data(), n, b.bins.data(), b.bins.size());
+        sliding_window_power(exp.bins.data(), exp.bins.size(), p);
+        r.bins.resize(n);
+        p.result(r.bins.data());
+        r.cleanBins();
+    } else {
+        DividedPowers p(m, b);
+        sliding_window_power(exp.bins.data(), exp.bins.size(), p);
+        swap(r, p.acc);
+    }
+
+    if (mod.is_negative() && !r.equals_int32(0))
+        r += mod;
+    return r;
+}
+
+ModContext::ModContext(const Int& modulus) : m(modulus) {
+    if (m.equals_int32(0))
+        throw divide_by_zero_error();
+    if (m.is_negative())
+        throw std::domain_error("ModContext: negative modulus");
+    m.cleanBins();
+    n = m.bins.size();
+
+    std::vector<bin_t> num(2 * n + 1, 0);
+    num[2 * n] = 1;
+    mu.resize(n + 2);
+    bins_divrem(mu.data(), NULL, num.data(), 2 * n + 1, m.bins.data(), n);
+    if (mu.back() == 0)         // only m = 2^(32(n - 1)) needs all n + 2 bins
+        mu.pop_back();
+}
+
+/* ModContext::reduce_bins - r = x mod m, for 0 <= x
+ *   Barrett's estimate of the quotient, q = floor(floor(x / B^(n-1)) * mu / B^(n+1))
+ *   (B = 2^32), is at most two too small for x < B^(2n). So x - q * m, which only
+ *   needs its low n + 1 bins, is below 3m and is finished off by subtraction.
+ */
+void ModContext::reduce_bins(const Int& x, Int& r) const {
+    size_t xn = x.bins.size();
+    if (xn < n || (xn == n && bins_cmp(x.bins.data(), m.bins.data(), n) < 0)) {
+        r = x;
+        r.negative = false;
+        return;
+    }
+    r.negative = false;
+    if (xn > 2 * n) {
+        r.bins.resize(n);
+        bins_divrem(NULL, r.bins.data(), x.bins.data(), xn, m.bins.data(), n);
+        r.cleanBins();
+        return;
+    }
+
+    std::vector<bin_t> xs(2 * n, 0), q(n + 1 + mu.size()), qm(2 * n + 1);
+    std::copy(x.bins.data(), x.bins.data() + xn, xs.begin());
+    bins_mul(q.data(), &xs[n - 1], n + 1, mu.data(), mu.size());
+    bins_mul(qm.data(), &q[n + 1], n + 1, m.bins.data(), n);
+
+    r.bins.resize(n + 1);
+    bins_sub(r.bins.data(), xs.data(), n + 1, qm.data(), n + 1);  // mod B^(n+1)
+    while (r.bins[n] != 0 || bins_cmp(r.bins.data(), m.bins.data(), n) >= 0)
+        r.bins[n] -= bins_sub(r.bins.data(), r.bins.data(), n, m.bins.data(), n);
+    r.cleanBins();
+}
+
+/* ModContext::reduce - x mod m, in [0, m) even for a negative x */
+Int ModContext::reduce(const Int& x) const {
+    Int r;
+    reduce_bins(x, r);
+    if (x.is_negative() && !r.equals_int32(0)) {
+        Int d(m);
+        d.subtract(r);
+        swap(r, d);
+    }
+    return r;
+}
+
+/* ModContext::mulmod - a * b mod m */
+Int ModContext::mulmod(const Int& a, const Int& b) const {
+    Int p;
+    if (is_reduced(a) && is_reduced(b))
+        multiply(a, b, p);
+    else
+        multiply(reduce(a), reduce(b), p);
+    Int r;
+    reduce_bins(p, r);
+    return r;
+}
+
+/* ModContext::addmod - a + b mod m */
+Int ModContext::addmod(const Int& a, const Int& b) const {
+    if (!is_reduced(a) || !is_reduced(b))
+        return reduce(a + b);
+    Int s(a);
+    s.add(b);
+    if (s >= m)
+        s.subtract(m);
+    return s;
+}
+
+/* ModContext::submod - a - b mod m */
+Int ModContext::submod(const Int& a, const Int& b) const {
+    if (!is_reduced(a) || !is_reduced(b))
+        return reduce(a - b);
+    Int d = a - b;
+    if (d.is_negative())
+        d += m;
+    return d;
+}
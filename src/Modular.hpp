@@ -0,0 +1,38 @@
+#ifndef _MODULAR_HPP_
+#define _MODULAR_HPP_
+#include <vector>
+#include "Int.hpp"
+
+/* ModContext - fast arithmetic modulo one fixed Int
+ *   The constructor does the one long division that Barrett reduction needs
+ *   (P. Barrett, 1986): mu = floor(2^(64n) / m) for an n-bin modulus m. After that,
+ *   reducing anything below m^2 (such as the product of two reduced numbers) costs
+ *   two multiplications and a subtraction or two, and no division.
+ *
+ *   All results are in [0, m). The arguments may be any Ints; ones outside [0, m)
+ *   are reduced first (longer than 2n bins takes a long division).
+ *
+ *   A ModContext is never modified after construction, and its methods keep their
+ *   temporaries local to the call, so there is no shared mutable state and one can
+ *   be shared by any number of threads.
+ */
+class ModContext {
+  public:
+    explicit ModContext(const Int& modulus);  /* throws unless modulus > 0 */
+
+    inline const Int& modulus() const { return m; }
+
+    Int reduce(const Int& x) const;
+    Int mulmod(const Int& a, const Int& b) const;
+    Int addmod(const Int& a, const Int& b) const;
+    Int submod(const Int& a, const Int& b) const;
+  private:
+    Int m;
+    size_t n;                   // bins in m
+    std::vector<Int::bin_t> mu; // floor(2^(64n) / m)
+
+    inline bool is_reduced(const Int& x) const { return !x.is_negative() && x < m; }
+    void reduce_bins(const Int& x, Int& r) const;
+};
+
+#endif
@@ -0,0 +1,644 @@
+#include <vector>
+#include <cstring>
+#include <cassert>
+#include "BinOps.hpp"
+#include "BinStorage.hpp"
+#include "Parallel.hpp"
+
+/* Multiply.cpp - multiplication algorithms on raw bins
+ *
+ * bins_mul() dispatches on operand size:
+ *   -- fewer than KARATSUBA_THRESHOLD bins: schoolbook (bins_mul_basecase)
+ *   -- otherwise: Karatsuba, which turns one n x n product into three n/2 x n/2
+ *      products, for O(n^1.585) time.
+ *   -- from TOOM3_THRESHOLD bins: Toom-3, five n/3 x n/3 products, O(n^1.465).
+ *   -- from TOOM4_THRESHOLD bins: Toom-4, seven n/4 x n/4 products, O(n^1.404).
+ *   -- from NTT_THRESHOLD bins: number-theoretic transforms, O(n log n).
+ * Operands of very different sizes are cut into pieces the size of the smaller one
+ * first, so the recursion always works on (nearly) balanced products.
+ * Squares (a and b the same array) are spotted at each level, and the small ones go
+ * to bins_sqr_basecase, which needs only about half the bin products.
+ *
+ * The thresholds are measured by demo/mul_bench.cpp.
+ *
+ * With PARALLEL_THREADS above 1 (see Parallel.hpp), products from MUL_PARALLEL_THRESHOLD
+ * bins are spread over threads: the three half-size products of Karatsuba, the 2k - 1
+ * products of Toom-k, and for NTT the three convolutions and the butterflies of each
+ * transform stage. Those are all independent, so the result is the same either way.
+ */
+
+size_t KARATSUBA_THRESHOLD = 32;
+size_t TOOM3_THRESHOLD = 200;
+size_t TOOM4_THRESHOLD = 600;
+size_t NTT_THRESHOLD = 3000;
+size_t MUL_PARALLEL_THRESHOLD = 2000;
+
+static void mul_rec(bin_t* r, const bin_t* a, size_t an, const bin_t* b, size_t bn, bin_t* scratch);
+
+/* The recursion needs each half to be smaller than the whole */
+static inline size_t karatsuba_threshold() {
+    return (KARATSUBA_THRESHOLD < 4) ? 4 : KARATSUBA_THRESHOLD;
+}
+
+/* whether a product with a smaller operand of bn bins is worth spreading over threads */
+static inline bool split_product(size_t bn) {
+    return PARALLEL_THREADS > 1 && bn >= MUL_PARALLEL_THRESHOLD;
+}
+
+/* karatsuba_scratch - the number of scratch bins mul_rec needs for a balanced n-bin product */
+static size_t karatsuba_scratch(size_t n) {
+    size_t s = 0, h;
+    while (n >= karatsuba_threshold()) {
+        h = (n + 1) / 2;
+        s += 4 * (h + 1);
+        n = h + 1;
+    }
+    return s;
+}
+
+/* karatsuba - r = a * b, where bn > (an + 1) / 2
+ *   Split at h = ceil(an / 2) bins: a = a1 * B^h + a0 and b = b1 * B^h + b0. Then
+ *      a * b = z2 * B^2h + (z1 - z2 - z0) * B^h + z0
+ *   where z0 = a0 * b0, z2 = a1 * b1 and z1 = (a0 + a1) * (b0 + b1).
+ *   z0 and z2 are computed directly into r, since they don't overlap.
+ */
+static void karatsuba(bin_t* r, const bin_t* a, size_t an, const bin_t* b, size_t bn, bin_t* scratch) {
+    size_t h = (an + 1) / 2;
+    size_t a1n = an - h, b1n = bn - h;
+    size_t z1n = 2 * h + 2;
+    bin_t* sa = scratch;            // a0 + a1: h + 1 bins
+    bin_t* sb = sa + h + 1;         // b0 + b1: h + 1 bins
+    bin_t* z1 = sb + h + 1;         // 2h + 2 bins
+    bin_t* next = z1 + z1n;
+
+    sa[h] = bins_add(sa, a, h, a + h, a1n);
+    if (a == b && an == bn)         // squaring: every product below is a square too
+        sb = sa;
+    else
+        sb[h] = bins_add(sb, b, h, b + h, b1n);
+    if (split_product(bn)) {
+        // the products write to separate places, but each needs its own scratch
+        BinBuffer<bin_t> next2(karatsuba_scratch(h + 1)), next3(karatsuba_scratch(h + 1));
+        std::vector<Task> tasks;
+        tasks.push_back([&] { mul_rec(r, a, h, b, h, next); });
+        tasks.push_back([&] { mul_rec(r + 2 * h, a + h, a1n, b + h, b1n, next2.data()); });
+        tasks.push_back([&] { mul_rec(z1, sa, h + 1, sb, h + 1, next3.data()); });
+        parallel_run(tasks);
+    } else {
+        mul_rec(r, a, h, b, h, next);
+        mul_rec(r + 2 * h, a + h, a1n, b + h, b1n, next);
+        mul_rec(z1, sa, h + 1, sb, h + 1, next);
+    }
+
+    bins_sub(z1, z1, z1n, r, 2 * h);
+    bins_sub(z1, z1, z1n, r + 2 * h, a1n + b1n);
+    // z1 < B^(an + bn - h), so any bins past that are zero
+    while (z1n > an + bn - h) {
+        assert(z1[z1n - 1] == 0);
+        --z1n;
+    }
+    bin_t carry = bins_add(r + h, r + h, an + bn - h, z1, z1n);
+    assert(carry == 0);
+    (void) carry;
+}
+
+/* SignedBins - a signed number, used for Toom-Cook evaluation and interpolation
+ *   The intermediate values there can be negative, which raw bins can't represent.
+ */
+struct SignedBins {
+    std::vector<bin_t> d;   // magnitude, least significant first, no high zero bins
+    bool neg;
+
+    SignedBins() : neg(false) { }
+    SignedBins(const bin_t* a, size_t n) : d(a, a + n), neg(false) { trim(); }
+
+    void trim() {
+        while (!d.empty() && d.back() == 0)
+            d.pop_back();
+        if (d.empty())
+            neg = false;
+    }
+
+    /* *this += (negate ? -y : y) */
+    void add(const SignedBins& y, bool negate = false) {
+        bool yneg = (y.neg != negate);
+        if (y.d.empty())
+            return;
+        if (neg == yneg) {
+            if (d.size() < y.d.size())
+                d.resize(y.d.size(), 0);
+            bin_t carry = bins_add(d.data(), d.data(), d.size(), y.d.data(), y.d.size());
+            if (carry)
+                d.push_back(carry);
+            return;
+        }
+        // signs differ: subtract the smaller magnitude from the larger
+        int32_t c = (d.size() != y.d.size()) ? ((d.size() < y.d.size()) ? -1 : 1)
+                                              : bins_cmp(d.data(), y.d.data(), d.size());
+        if (c >= 0) {
+            bins_sub(d.data(), d.data(), d.size(), y.d.data(), y.d.size());
+        } else {
+            std::vector<bin_t> m(y.d);
+            bins_sub(m.data(), m.data(), m.size(), d.data(), d.size());
+            d.swap(m);
+            neg = yneg;
+        }
+        trim();
+    }
+
+    /* *this *= s */
+    void mul_small(int32_t s) {
+        if (s < 0)
+            neg = !neg;
+        bin_t m = (bin_t) ((s < 0) ? -s : s);
+        if (!d.empty()) {
+            bin_t carry = bins_mul_1(d.data(), d.data(), d.size(), m);
+            if (carry)
+                d.push_back(carry);
+        }
+        trim();
+    }
+
+    /* *this /= s, where s is known to divide *this */
+    void divexact_small(int32_t s) {
+        if (s < 0)
+            neg = !neg;
+        if (!d.empty())
+            bins_divexact_1(d.data(), d.data(), d.size(), (bin_t) ((s < 0) ? -s : s));
+        trim();
+    }
+
+    /* *this = x * y */
+    void set_product(const SignedBins& x, const SignedBins& y) {
+        if (x.d.empty() || y.d.empty()) {
+            d.clear();
+            neg = false;
+            return;
+        }
+        d.assign(x.d.size() + y.d.size(), 0);
+        bins_mul(d.data(), x.d.data(), x.d.size(), y.d.data(), y.d.size());
+        neg = (x.neg != y.neg);
+        trim();
+    }
+};
+
+/* Interpolation nodes for Toom-Cook, besides infinity */
+static const int32_t TOOM_NODES[] = { 0, 1, -1, 2, -2, 3, -3 };
+
+/* toom_eval - evaluate the polynomial with coefficients pieces at x = p (Horner's rule) */
+static void toom_eval(const std::vector<SignedBins>& pieces, int32_t p, SignedBins& result) {
+    result = pieces.back();
+    for (size_t i = pieces.size() - 1; i-- > 0; ) {
+        result.mul_small(p);
+        result.add(pieces[i]);
+    }
+}
+
+/* toom - r = a * b by Toom-Cook k-way splitting, where bn > (k - 1) * ceil(an / k)
+ *   Cut a and b into k pieces of m bins each, and view them as polynomials in x = B^m.
+ *   Their product has degree D = 2k - 2, so it is determined by its leading coefficient
+ *   (the product of the top pieces, its "value at infinity") and its values at D other points.
+ *   Those D values are products of pieces-sized numbers, which recurse through bins_mul.
+ *
+ *   The coefficients are recovered with Newton's divided differences over the integer nodes
+ *   TOOM_NODES. For a polynomial with integer coefficients, every divided difference at
+ *   integer nodes is an integer, so each division below is exact.
+ */
+static void toom(bin_t* r, const bin_t* a, size_t an, const bin_t* b, size_t bn, size_t k) {
+    size_t m = (an + k - 1) / k;
+    size_t D = 2 * k - 2;
+    std::vector<SignedBins> ap(k), bp(k);
+    for (size_t i = 0; i < k; ++i) {
+        if (i * m < an)
+            ap[i] = SignedBins(a + i * m, (an - i * m < m) ? an - i * m : m);
+        if (i * m < bn)
+            bp[i] = SignedBins(b + i * m, (bn - i * m < m) ? bn - i * m : m);
+    }
+
+    // the value at infinity, and the products at the finite nodes with its term removed
+    SignedBins top, tmp;
+    std::vector<SignedBins> ea(D), eb(D), v(D);
+    for (size_t i = 0; i < D; ++i) {
+        toom_eval(ap, TOOM_NODES[i], ea[i]);
+        toom_eval(bp, TOOM_NODES[i], eb[i]);
+    }
+    if (split_product(bn)) {
+        std::vector<Task> tasks;
+        tasks.push_back([&] { top.set_product(ap[k - 1], bp[k - 1]); });
+        for (size_t i = 0; i < D; ++i)
+            tasks.push_back([&, i] { v[i].set_product(ea[i], eb[i]); });
+        parallel_run(tasks);
+    } else {
+        top.set_product(ap[k - 1], bp[k - 1]);
+        for (size_t i = 0; i < D; ++i)
+            v[i].set_product(ea[i], eb[i]);
+    }
+    for (size_t i = 0; i < D; ++i) {
+        int32_t p = TOOM_NODES[i], pD = 1;
+        for (size_t j = 0; j < D; ++j)
+            pD *= p;
+        tmp = top;
+        tmp.mul_small(pD);
+        v[i].add(tmp, true);
+    }
+
+    // divided differences: afterwards v[i] is the i-th Newton coefficient
+    for (size_t j = 1; j < D; ++j) {
+        for (size_t i = D - 1; i >= j; --i) {
+            v[i].add(v[i - 1], true);
+            v[i].divexact_small(TOOM_NODES[i] - TOOM_NODES[i - j]);
+        }
+    }
+
+    // Newton form to monomial form: c = c * (x - p_i) + v[i], from the top down
+    std::vector<SignedBins> c(D);
+    c[0] = v[D - 1];
+    for (size_t i = D - 1, deg = 0; i-- > 0; ++deg) {
+        int32_t p = TOOM_NODES[i];
+        c[deg + 1] = c[deg];
+        for (size_t j = deg; j >= 1; --j) {
+            c[j].mul_small(-p);
+            c[j].add(c[j - 1]);
+        }
+        c[0].mul_small(-p);
+        c[0].add(v[i]);
+    }
+
+    // r = sum of c[j] * x^j, plus top * x^D
+    size_t rn = an + bn, off;
+    memset(r, 0, rn * sizeof(bin_t));
+    for (size_t j = 0; j <= D; ++j) {
+        const SignedBins& cj = (j == D) ? top : c[j];
+        off = j * m;
+        assert(!cj.neg && off + cj.d.size() <= rn);
+        if (!cj.d.empty()) {
+            bin_t carry = bins_add(r + off, r + off, rn - off, cj.d.data(), cj.d.size());
+            assert(carry == 0);
+            (void) carry;
+        }
+    }
+}
+
+/* === Number-theoretic transform (NTT) multiplication ===
+ *
+ * The product of a and b is the convolution of their bins, carried. The convolution
+ * is computed exactly modulo three primes p = c * 2^k + 1 below 2^31, using transforms
+ * over the integers mod p (where roots of unity of order 2^k exist), and recombined
+ * with the Chinese remainder theorem. There is no floating point, so no rounding risk.
+ *
+ * Each convolution term is less than min(an, bn) * 2^64. The primes' product is about
+ * 2^90.5, so the result is exact for transforms of up to 2^NTT_MAX_LOG terms, which
+ * covers products of up to 2^26 bins (about 646 million decimal digits). Bigger
+ * products fall back to Toom-Cook, whose pieces come back here.
+ */
+
+struct NttPrime {
+    bin_t p;
+    bin_t g;    // a primitive root mod p
+};
+static const NttPrime NTT_PRIMES[3] = {
+    { 2013265921u, 31 },    // 15 * 2^27 + 1
+    { 1811939329u, 13 },    // 27 * 2^26 + 1
+    { 469762049u, 3 },      //  7 * 2^26 + 1
+};
+static const uint32_t NTT_MAX_LOG = 26;
+
+/* Montgomery - arithmetic mod an odd p < 2^31 without division
+ *   mul(a, b) returns a * b / 2^32 mod p. Multiplying by a constant stored
+ *   as c * 2^32 mod p (see to_mont) therefore gives a plain a * c mod p.
+ */
+struct Montgomery {
+    bin_t p;
+    bin_t pinv;     // -p^-1 mod 2^32
+    bin_t r2;       // 2^64 mod p
+
+    explicit Montgomery(bin_t _p) : p(_p) {
+        bin_t inv = p;
+        for (int i = 0; i < 4; ++i)
+            inv *= 2 - p * inv;
+        pinv = -inv;
+        uint64_t r = ((uint64_t) 1 << 32) % p;
+        r2 = (bin_t) (r * r % p);
+    }
+    inline bin_t reduce(uint64_t t) const {
+        bin_t m = (bin_t) t * pinv;
+        bin_t u = (bin_t) ((t + (uint64_t) m * p) >> 32);
+        return (u >= p) ? u - p : u;
+    }
+    inline bin_t mul(bin_t a, bin_t b) const { return reduce((uint64_t) a * b); }
+    inline bin_t to_mont(bin_t a) const { return mul(a, r2); }
+    inline bin_t add(bin_t a, bin_t b) const { bin_t s = a + b; return (s >= p) ? s - p : s; }
+    inline bin_t sub(bin_t a, bin_t b) const { return (a >= b) ? a - b : a + p - b; }
+};
+
+static bin_t pow_mod(bin_t b, uint64_t e, bin_t p) {
+    uint64_t r = 1, x = b % p;
+    for (; e > 0; e >>= 1) {
+        if (e & 1)
+            r = r * x % p;
+        x = x * x % p;
+    }
+    return (bin_t) r;
+}
+
+/* ntt_twiddles - w^j for j < n/2 (in Montgomery form), where w has order n */
+static void ntt_twiddles(const Montgomery& m, bin_t w, size_t n, std::vector<bin_t>& tw) {
+    tw.resize(n / 2);
+    bin_t wm = m.to_mont(w), x = m.to_mont(1);
+    for (size_t j = 0; j < n / 2; ++j) {
+        tw[j] = x;
+        x = m.mul(x, wm);
+    }
+}
+
+/* The fewest butterflies worth handing to another thread */
+static const size_t NTT_MIN_CHUNK = 4096;
+
+/* ntt_stage - one stage of a transform, spread over threads
+ *   A stage is n / len blocks of len / 2 butterflies each, and run(i0, i1, j0, j1)
+ *   does butterflies j0 <= j < j1 of the blocks starting from i0 up to i1. The
+ *   butterflies are independent, so a big stage is cut up, into runs of whole blocks
+ *   or, when there are only a few blocks, into parts of each block, one task each.
+ */
+template <typename F>
+static void ntt_stage(size_t n, size_t len, const F& run) {
+    size_t half = len / 2;
+    size_t chunks = n / 2 / NTT_MIN_CHUNK;
+    if (chunks > 4 * PARALLEL_THREADS)
+        chunks = 4 * PARALLEL_THREADS;
+    if (chunks < 2) {
+        run(0, n, 0, half);
+        return;
+    }
+    std::vector<Task> tasks;
+    size_t blocks = n / len;
+    if (blocks >= chunks) {
+        for (size_t c = 0; c < chunks; ++c) {
+            size_t i0 = blocks * c / chunks * len, i1 = blocks * (c + 1) / chunks * len;
+            tasks.push_back([&run, i0, i1, half] { run(i0, i1, 0, half); });
+        }
+    } else {
+        size_t parts = (chunks + blocks - 1) / blocks;
+        for (size_t i = 0; i < n; i += len) {
+            for (size_t c = 0; c < parts; ++c) {
+                size_t j0 = half * c / parts, j1 = half * (c + 1) / parts;
+                tasks.push_back([&run, i, len, j0, j1] { run(i, i + len, j0, j1); });
+            }
+        }
+    }
+    parallel_run(tasks);
+}
+
+/* ntt_forward_run - butterflies [j0, j1) of the forward stage's blocks of len terms in [i0, i1)
+ *   m is passed by value: through a reference, p and pinv would have to be reloaded
+ *   after every store to a, which may alias them.
+ */
+static void ntt_forward_run(const Montgomery m, bin_t* a, size_t len, const bin_t* tw, size_t stride,
+                            size_t i0, size_t i1, size_t j0, size_t j1) {
+    size_t half = len / 2;
+    bin_t u, v;
+    for (size_t i = i0; i < i1; i += len) {
+        for (size_t j = j0; j < j1; ++j) {
+            u = a[i + j];
+            v = a[i + j + half];
+            a[i + j] = m.add(u, v);
+            a[i + j + half] = m.mul(m.sub(u, v), tw[j * stride]);
+        }
+    }
+}
+
+/* ntt_inverse_run - butterflies [j0, j1) of the inverse stage's blocks of len terms in [i0, i1) */
+static void ntt_inverse_run(const Montgomery m, bin_t* a, size_t len, const bin_t* itw, size_t stride,
+                            size_t i0, size_t i1, size_t j0, size_t j1) {
+    size_t half = len / 2;
+    bin_t u, v;
+    for (size_t i = i0; i < i1; i += len) {
+        for (size_t j = j0; j < j1; ++j) {
+            u = a[i + j];
+            v = m.mul(a[i + j + half], itw[j * stride]);
+            a[i + j] = m.add(u, v);
+            a[i + j + half] = m.sub(u, v);
+        }
+    }
+}
+
+/* ntt_forward - decimation in frequency; natural order in, bit-reversed order out */
+static void ntt_forward(const Montgomery& m, bin_t* a, size_t n, const bin_t* tw, bool split) {
+    for (size_t len = n, stride = 1; len >= 2; len >>= 1, stride <<= 1) {
+        if (!split) {
+            ntt_forward_run(m, a, len, tw, stride, 0, n, 0, len / 2);
+            continue;
+        }
+        ntt_stage(n, len, [&m, a, len, tw, stride](size_t i0, size_t i1, size_t j0, size_t j1) {
+            ntt_forward_run(m, a, len, tw, stride, i0, i1, j0, j1);
+        });
+    }
+}
+
+/* ntt_inverse - decimation in time; bit-reversed order in, natural order out (unscaled) */
+static void ntt_inverse(const Montgomery& m, bin_t* a, size_t n, const bin_t* itw, bool split) {
+    for (size_t len = 2, stride = n / 2; len <= n; len <<= 1, stride >>= 1) {
+        if (!split) {
+            ntt_inverse_run(m, a, len, itw, stride, 0, n, 0, len / 2);
+            continue;
+        }
+        ntt_stage(n, len, [&m, a, len, itw, stride](size_t i0, size_t i1, size_t j0, size_t j1) {
+            ntt_inverse_run(m, a, len, itw, stride, i0, i1, j0, j1);
+        });
+    }
+}
+
+/* ntt_convolve - res = the convolution of a and b mod prime, padded to n = 2^lg terms */
+static void ntt_convolve(const NttPrime& prime, const bin_t* a, size_t an, const bin_t* b, size_t bn,
+                         uint32_t lg, std::vector<bin_t>& res, bool split) {
+    const Montgomery m(prime.p);
+    size_t n = (size_t) 1 << lg;
+    bin_t w = pow_mod(prime.g, (prime.p - 1) >> lg, prime.p);
+    std::vector<bin_t> tw, fb;
+    bool square = (a == b && an == bn);
+
+    ntt_twiddles(m, w, n, tw);
+    res.assign(n, 0);
+    for (size_t i = 0; i < an; ++i)
+        res[i] = a[i] % prime.p;
+    ntt_forward(m, res.data(), n, tw.data(), split);
+    if (square) {
+        for (size_t i = 0; i < n; ++i)
+            res[i] = m.mul(res[i], res[i]);
+    } else {
+        fb.assign(n, 0);
+        for (size_t i = 0; i < bn; ++i)
+            fb[i] = b[i] % prime.p;
+        ntt_forward(m, fb.data(), n, tw.data(), split);
+        for (size_t i = 0; i < n; ++i)
+            res[i] = m.mul(res[i], fb[i]);
+    }
+
+    // the pointwise products picked up a factor 2^-32, and the inverse transform a factor n
+    ntt_twiddles(m, pow_mod(w, prime.p - 2, prime.p), n, tw);
+    ntt_inverse(m, res.data(), n, tw.data(), split);
+    bin_t scale = m.to_mont((bin_t) ((uint64_t) pow_mod(2, 32, prime.p)
+                                     * pow_mod((bin_t) (n % prime.p), prime.p - 2, prime.p) % prime.p));
+    for (size_t i = 0; i < n; ++i)
+        res[i] = m.mul(res[i], scale);
+}
+
+/* ntt_mul - r = a * b through three modular convolutions and the CRT */
+static void ntt_mul(bin_t* r, const bin_t* a, size_t an, const bin_t* b, size_t bn) {
+    size_t rn = an + bn;
+    uint32_t lg = 0;
+    while (((size_t) 1 << lg) < rn - 1)
+        ++lg;
+    size_t n = (size_t) 1 << lg;
+    std::vector<bin_t> res[3];
+    if (split_product(bn)) {
+        std::vector<Task> tasks;
+        for (int k = 0; k < 3; ++k)
+            tasks.push_back([&, k] { ntt_convolve(NTT_PRIMES[k], a, an, b, bn, lg, res[k], true); });
+        parallel_run(tasks);
+    } else {
+        for (int k = 0; k < 3; ++k)
+            ntt_convolve(NTT_PRIMES[k], a, an, b, bn, lg, res[k], false);
+    }
+
+    /* Garner's algorithm: each term is x = x1 + p1 * (v2 + p2 * v3), which is carried
+     * into r. The carry (c0, c1, c2) stays below 2^96. */
+    const uint64_t p1 = NTT_PRIMES[0].p, p2 = NTT_PRIMES[1].p, p3 = NTT_PRIMES[2].p;
+    const uint64_t inv_p1 = pow_mod((bin_t) (p1 % p2), p2 - 2, (bin_t) p2);            // mod p2
+    const uint64_t inv_p1p2 = pow_mod((bin_t) (p1 * p2 % p3), p3 - 2, (bin_t) p3);     // mod p3
+    const uint64_t p1p2 = p1 * p2;
+    const uint64_t MASK = 0xffffffffULL;
+    uint64_t c0 = 0, c1 = 0, c2 = 0, x1, v2, v3, t, m0, m1, w0, w1, w2;
+    for (size_t i = 0; i < rn; ++i) {
+        if (i < n) {
+            x1 = res[0][i];
+            v2 = (res[1][i] + p2 - x1 % p2) % p2 * inv_p1 % p2;
+            t = x1 + p1 * v2;
+            v3 = (res[2][i] + p3 - t % p3) % p3 * inv_p1p2 % p3;
+        } else {
+            t = v3 = 0;
+        }
+        m0 = (p1p2 & MASK) * v3;
+        m1 = (p1p2 >> 32) * v3;
+        w0 = (t & MASK) + (m0 & MASK) + c0;
+        w1 = (t >> 32) + (m0 >> 32) + (m1 & MASK) + c1 + (w0 >> 32);
+        w2 = (m1 >> 32) + c2 + (w1 >> 32);
+        r[i] = (bin_t) w0;
+        c0 = w1 & MASK;
+        c1 = w2 & MASK;
+        c2 = w2 >> 32;
+    }
+    assert(c0 == 0 && c1 == 0 && c2 == 0);
+}
+
+/* ntt_fits - whether the product is small enough for an exact transform */
+static inline bool ntt_fits(size_t an, size_t bn) {
+    return an + bn - 1 <= ((size_t) 1 << NTT_MAX_LOG);
+}
+
+/* toom_fits - whether b is big enough to fill all k pieces of a k-way split of a */
+static inline bool toom_fits(size_t an, size_t bn, size_t k) {
+    return bn > (k - 1) * ((an + k - 1) / k);
+}
+
+/* mul_unbalanced - r = a * b, where an is much bigger than bn
+ *   a is cut into bn-bin pieces, and each piece's product with b is added into r.
+ */
+static void mul_unbalanced(bin_t* r, const bin_t* a, size_t an, const bin_t* b, size_t bn) {
+    BinBuffer<bin_t> tmp(2 * bn + karatsuba_scratch(bn));
+    bin_t* prod = tmp.data();
+    bin_t* scratch = prod + 2 * bn;
+    size_t n;
+
+    mul_rec(r, a, bn, b, bn, scratch);
+    for (size_t i = bn; i < an; i += bn) {
+        n = (an - i < bn) ? an - i : bn;
+        mul_rec(prod, a + i, n, b, bn, scratch);
+        // r is filled up to bin i + bn; add the top of it onto this piece
+        bin_t carry = bins_add(r + i, prod, n + bn, r + i, bn);
+        assert(carry == 0);
+        (void) carry;
+    }
+}
+
+static void mul_rec(bin_t* r, const bin_t* a, size_t an, const bin_t* b, size_t bn, bin_t* scratch) {
+    if (an < bn) {
+        const bin_t* t = a; a = b; b = t;
+        size_t tn = an; an = bn; bn = tn;
+    }
+    if (a == b && an == bn && bn < karatsuba_threshold())
+        bins_sqr_basecase(r, a, an);
+    else if (bn < karatsuba_threshold())
+        bins_mul_basecase(r, a, an, b, bn);
+    else if (bn >= NTT_THRESHOLD && ntt_fits(an, bn))
+        ntt_mul(r, a, an, b, bn);
+    else if (2 * bn <= an + 1)
+        mul_unbalanced(r, a, an, b, bn);
+    else if (bn >= TOOM4_THRESHOLD && toom_fits(an, bn, 4))
+        toom(r, a, an, b, bn, 4);
+    else if (bn >= TOOM3_THRESHOLD && toom_fits(an, bn, 3))
+        toom(r, a, an, b, bn, 3);
+    else
+        karatsuba(r, a, an, b, bn, scratch);
+}
+
+void bins_mul(bin_t* r, const bin_t* a, size_t an, const bin_t* b, size_t bn) {
+    if (an < bn) {
+        const bin_t* t = a; a = b; b = t;
+        size_t tn = an; an = bn; bn = tn;
+    }
+    if (a == b && an == bn && bn < karatsuba_threshold()) {
+        bins_sqr_basecase(r, a, an);
+    } else if (bn < karatsuba_threshold()) {
+        bins_mul_basecase(r, a, an, b, bn);
+    } else if (bn >= NTT_THRESHOLD && ntt_fits(an, bn)) {
+        ntt_mul(r, a, an, b, bn);
+    } else {
+        BinBuffer<bin_t> scratch(karatsuba_scratch(an) + 1);
+        mul_rec(r, a, an, b, bn, scratch.data());
+    }
+}
+
+/* bins_addmul - r[0..rn) += a * b, returning the carry out of r
+ *   Short products are added straight into r a row at a time (as in the
+ *   schoolbook method), so no product is ever formed on its own. Longer ones
+ *   go through bins_mul into a scratch array and are added on in one pass.
+ */
+bin_t bins_addmul(bin_t* r, size_t rn, const bin_t* a, size_t an, const bin_t* b, size_t bn) {
+    if (an < bn) {
+        const bin_t* t = a; a = b; b = t;
+        size_t tn = an; an = bn; bn = tn;
+    }
+    assert(rn >= an + bn);
+    if (bn < karatsuba_threshold()) {
+        bin_t carry = 0;
+        for (size_t j = 0; j < bn; ++j) {
+            bin_t c = bins_addmul_1(r + j, a, an, b[j]);
+            carry += bins_add_1(r + j + an, r + j + an, rn - j - an, c);
+        }
+        return carry;
+    }
+    BinBuffer<bin_t> prod(an + bn);
+    bins_mul(prod.data(), a, an, b, bn);
+    return bins_add(r, r, rn, prod.data(), an + bn);
+}
+
+/* bins_submul - r[0..rn) -= a * b, returning the borrow out of r (see bins_addmul) */
+bin_t bins_submul(bin_t* r, size_t rn, const bin_t* a, size_t an, const bin_t* b, size_t bn) {
+    if (an < bn) {
+        const bin_t* t = a; a = b; b = t;
+        size_t tn = an; an = bn; bn = tn;
+    }
+    assert(rn >= an + bn);
+    if (bn < karatsuba_threshold()) {
+        bin_t borrow = 0;
+        for (size_t j = 0; j < bn; ++j) {
+            bin_t c = bins_submul_1(r + j, a, an, b[j]);
+            borrow += bins_sub_1(r + j + an, r + j + an, rn - j - an, c);
+        }
+        return borrow;
+    }
+    BinBuffer<bin_t> prod(an + bn);
+    bins_mul(prod.data(), a, an, b, bn);
+    return bins_sub(r, r, rn, prod.data(), an + bn);
+}
@@ -0,0 +1,140 @@
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <system_error>
+#include "Parallel.hpp"
+
+/* Parallel.cpp - the worker pool behind parallel_run() (see Parallel.hpp) */
+
+size_t PARALLEL_THREADS = 1;
+
+/* Batch - the tasks of one parallel_run() call that are yet to finish */
+struct Batch {
+    size_t left;
+    std::exception_ptr error;
+};
+
+struct Job {
+    Task* task;
+    Batch* batch;
+};
+
+class WorkerPool {
+  public:
+    WorkerPool() : workers_running(0), active(0), stopping(false) { }
+    ~WorkerPool() {
+        std::unique_lock<std::mutex> lock(mu);
+        stop(lock);
+    }
+
+    void run(std::vector<Task>& tasks) {
+        std::unique_lock<std::mutex> lock(mu);
+        size_t want = (PARALLEL_THREADS > 1) ? PARALLEL_THREADS - 1 : 0;
+        if (active == 0 && workers_running != want)
+            resize(want, lock);
+        if (workers_running == 0 || tasks.size() < 2) {
+            lock.unlock();
+            for (size_t i = 0; i < tasks.size(); ++i)
+                tasks[i]();
+            return;
+        }
+
+        ++active;
+        Batch batch;
+        batch.left = tasks.size();
+        for (size_t i = 1; i < tasks.size(); ++i) {
+            Job j = { &tasks[i], &batch };
+            queue.push_back(j);
+        }
+        cv.notify_all();
+        Job first = { &tasks[0], &batch };
+        execute(first, lock);
+        while (batch.left > 0) {
+            if (!queue.empty()) {
+                Job j = queue.back();
+                queue.pop_back();
+                execute(j, lock);
+            } else {
+                cv.wait(lock);
+            }
+        }
+        --active;
+        lock.unlock();
+        if (batch.error)
+            std::rethrow_exception(batch.error);
+    }
+  private:
+    std::mutex mu;                  // guards everything below
+    std::condition_variable cv;     // signalled on new jobs, finished batches and stopping
+    std::deque<Job> queue;
+    std::vector<std::thread> workers;
+    size_t workers_running;         // 0 while the workers are being replaced
+    size_t active;                  // batches under way
+    bool stopping;
+
+    /* run j with the lock released, and count it off its batch */
+    void execute(Job j, std::unique_lock<std::mutex>& lock) {
+        std::exception_ptr error;
+        lock.unlock();
+        try {
+            (*j.task)();
+        } catch (...) {
+            error = std::current_exception();
+        }
+        lock.lock();
+        if (error && !j.batch->error)
+            j.batch->error = error;
+        if (--j.batch->left == 0)
+            cv.notify_all();
+    }
+
+    void work() {
+        std::unique_lock<std::mutex> lock(mu);
+        while (true) {
+            while (!stopping && queue.empty())
+                cv.wait(lock);
+            if (stopping)
+                return;
+            Job j = queue.front();
+            queue.pop_front();
+            execute(j, lock);
+        }
+    }
+
+    /* resize - replace the workers with n new ones; only called with no batch under way */
+    void resize(size_t n, std::unique_lock<std::mutex>& lock) {
+        ++active;                   // no one else resizes meanwhile, and they run their batches alone
+        stop(lock);
+        try {
+            while (workers.size() < n)
+                workers.push_back(std::thread(&WorkerPool::work, this));
+        } catch (const std::system_error&) {
+            // go on with the workers we could start
+        }
+        workers_running = workers.size();
+        --active;
+    }
+
+    void stop(std::unique_lock<std::mutex>& lock) {
+        workers_running = 0;
+        stopping = true;
+        cv.notify_all();
+        lock.unlock();
+        for (size_t i = 0; i < workers.size(); ++i)
+            workers[i].join();
+        lock.lock();
+        workers.clear();
+        stopping = false;
+    }
+};
+
+static WorkerPool& pool() {
+    static WorkerPool p;            // a function-local static, so it's ready for other static initializers
+    return p;
+}
+
+void parallel_run(std::vector<Task>& tasks) {
+    pool().run(tasks);
+}
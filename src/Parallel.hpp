@@ -0,0 +1,29 @@
+#ifndef _PARALLEL_HPP_
+#define _PARALLEL_HPP_
+#include <vector>
+#include <functional>
+#include "common.hpp"
+
+/* Parallel - a shared pool of worker threads for splitting up big computations
+ *   parallel_run() runs a batch of tasks spread over the pool, and returns once all
+ *   of them are done. The caller runs the first task itself, and while it waits for
+ *   the rest it runs whatever tasks are queued, its own or anyone's. So a task may
+ *   start a batch of its own (as the halves of a big product do) without tying up
+ *   a thread per level. Waiting threads take the newest task in the queue and idle
+ *   workers the oldest, so a worker usually picks up the biggest piece left.
+ *
+ *   The pool has PARALLEL_THREADS - 1 workers (the calling thread makes up the last
+ *   one). It is started the first time it is needed, and restarted when
+ *   PARALLEL_THREADS has changed and no batch is running. With PARALLEL_THREADS at
+ *   1 (the default) there are no workers, and the tasks run one after another on
+ *   the calling thread. If a task throws, the batch still finishes, and the first
+ *   exception is rethrown to the caller.
+ */
+typedef std::function<void()> Task;
+
+void parallel_run(std::vector<Task>& tasks);
+
+/* The number of threads parallel_run() may use, counting the caller. Tunable. */
+extern size_t PARALLEL_THREADS;
+
+#endif
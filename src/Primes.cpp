@@ -0,0 +1,278 @@
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include "Primes.hpp"
+#include "Modular.hpp"
+#include "BinOps.hpp"
+#include "SlidingWindow.hpp"
+#include "Parallel.hpp"
+
+/* Primes.cpp - primality tests and the segmented sieve
+ *
+ * Below 2^64, a number is prime exactly when it is a strong probable prime to
+ * Sinclair's seven bases, which were found by exhaustive search. Above that,
+ * is_prime() is the Baillie-PSW test: a strong probable prime test to base 2 and
+ * a strong Lucas probable prime test with Selfridge's parameters (R. Baillie and
+ * S. Wagstaff, "Lucas Pseudoprimes", 1980). Their pseudoprimes seem to fall in
+ * different residue classes, and no number is known to pass both and be composite.
+ * Trial division by small primes weeds out most composites before either.
+ *
+ * primes_between() sieves the odd numbers one segment at a time, with one byte per
+ * number and segments that fit in the L1 cache, crossing off multiples of the primes
+ * up to the square root of the range's end (which are found the same way).
+ */
+
+/* strong_probable_prime64 - whether the odd n > 2 passes the Miller-Rabin test to base a */
+static bool strong_probable_prime64(uint64_t n, uint64_t a) {
+    a %= n;
+    if (a == 0)
+        return true;
+    uint64_t d = n - 1, x = 1;
+    uint32_t s = 0;
+    while (d % 2 == 0) {
+        d /= 2;
+        ++s;
+    }
+    for (; d > 0; d >>= 1) {
+        if (d & 1)
+            x = mulmod64(x, a, n);
+        a = mulmod64(a, a, n);
+    }
+    if (x == 1 || x == n - 1)
+        return true;
+    for (uint32_t i = 1; i < s; ++i) {
+        x = mulmod64(x, x, n);
+        if (x == n - 1)
+            return true;
+    }
+    return false;
+}
+
+static const uint32_t SMALL_PRIMES[] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47 };
+static const size_t NUM_SMALL_PRIMES = sizeof(SMALL_PRIMES) / sizeof(SMALL_PRIMES[0]);
+
+bool is_prime(uint64_t n) {
+    if (n < 2)
+        return false;
+    for (size_t i = 0; i < NUM_SMALL_PRIMES; ++i)
+        if (n % SMALL_PRIMES[i] == 0)
+            return n == SMALL_PRIMES[i];
+    if (n < 53 * 53)
+        return true;
+    static const uint64_t bases[] = { 2, 325, 9375, 28178, 450775, 9780504, 1795265022 };
+    for (size_t i = 0; i < 7; ++i)
+        if (!strong_probable_prime64(n, bases[i]))
+            return false;
+    return true;
+}
+
+/* jacobi64 - the Jacobi symbol (a / m), for odd m */
+static int32_t jacobi64(uint64_t a, uint64_t m) {
+    int32_t j = 1;
+    a %= m;
+    while (a != 0) {
+        while (a % 2 == 0) {
+            a /= 2;
+            if (m % 8 == 3 || m % 8 == 5)
+                j = -j;
+        }
+        uint64_t t = a;
+        a = m;
+        m = t;
+        if (a % 4 == 3 && m % 4 == 3)
+            j = -j;
+        a %= m;
+    }
+    return (m == 1) ? j : 0;
+}
+
+/* half - x / 2 mod the odd n, for 0 <= x < n */
+static inline void half(Int& x, const Int& n) {
+    if (x.is_odd())
+        x += n;
+    x.shift_right(1);
+}
+
+/* strong_lucas - whether n passes the strong Lucas test with P = 1 and Q = (1 - D) / 4
+ *   n + 1 = d * 2^s with d odd, and d[0..dn) holds the bins of d. U and V are worked out
+ *   at k = d by doubling (U_2k = U_k V_k, V_2k = V_k^2 - 2Q^k) and stepping up by one
+ *   (U_k+1 = (U_k + V_k) / 2, V_k+1 = (D U_k + V_k) / 2). n passes if U_d is 0 or
+ *   V_(d 2^r) is 0 for some r < s.
+ */
+static bool strong_lucas(const Int& n, const ModContext& mc, int64_t D, const bin_t* d, size_t dn, size_t s) {
+    Int dm = mc.reduce(Int(D)), q = mc.reduce(Int((1 - D) / 4));
+    Int u(1), v(1), qk(q), t;
+    size_t bits = dn * BINOPS_BITS;
+    while (exp_bit(d, bits - 1) == 0)
+        --bits;
+    for (size_t i = bits - 1; i-- > 0; ) {
+        u = mc.mulmod(u, v);
+        v = mc.submod(mc.mulmod(v, v), mc.addmod(qk, qk));
+        qk = mc.mulmod(qk, qk);
+        if (exp_bit(d, i)) {
+            t = mc.addmod(u, v);
+            v = mc.addmod(mc.mulmod(dm, u), v);
+            u = t;
+            half(u, n);
+            half(v, n);
+            qk = mc.mulmod(qk, q);
+        }
+    }
+    if (u.equals_int32(0) || v.equals_int32(0))
+        return true;
+    for (size_t r = 1; r < s; ++r) {
+        v = mc.submod(mc.mulmod(v, v), mc.addmod(qk, qk));
+        if (v.equals_int32(0))
+            return true;
+        qk = mc.mulmod(qk, qk);
+    }
+    return false;
+}
+
+/* trailing_zeros - the number of zero bits below the lowest one bit of a, for a != 0 */
+static size_t trailing_zeros(const bin_t* a) {
+    size_t i = 0, z = 0;
+    while (a[i] == 0)
+        ++i;
+    for (bin_t x = a[i]; (x & 1) == 0; x >>= 1)
+        ++z;
+    return i * BINOPS_BITS + z;
+}
+
+/* Trial division goes up to here, a bin's worth of primes at a time */
+static const uint32_t TRIAL_LIMIT = 2000;
+
+bool is_prime(const Int& n) {
+    if (n.negative)
+        return false;
+    if (n.bins.size() <= 2)
+        return is_prime((uint64_t) n.bins[0] | ((n.bins.size() == 2) ? (uint64_t) n.bins[1] << Int::BIN_WIDTH : 0));
+    if (!n.is_odd())
+        return false;
+
+    static const std::vector<uint64_t> trial = primes_between(3, TRIAL_LIMIT);
+    for (size_t i = 0; i < trial.size(); ) {
+        size_t j = i;
+        uint64_t m = 1;
+        while (j < trial.size() && m * trial[j] <= 0xFFFFFFFFULL)
+            m *= trial[j++];
+        bin_t r = bins_mod_1(n.bins.data(), n.bins.size(), (bin_t) m);
+        for (; i < j; ++i)
+            if (r % trial[i] == 0)
+                return false;
+    }
+
+    // strong probable prime to base 2: n - 1 = d * 2^s
+    ModContext mc(n);
+    Int d = n - Int(1), x;
+    size_t s = trailing_zeros(d.bins.data());
+    d.shift_right(s);
+    x = powmod(Int(2), d, n);
+    Int minus_one = n - Int(1);
+    if (!x.equals_int32(1) && x != minus_one) {
+        for (size_t r = 1; r < s && x != minus_one; ++r)
+            x = mc.mulmod(x, x);
+        if (x != minus_one)
+            return false;
+    }
+
+    // Selfridge's D: the first of 5, -7, 9, -11, ... with (D / n) = -1. A square n
+    // has none, so squares are ruled out first.
+    Int root = isqrt(n);
+    if (root * root == n)
+        return false;
+    int64_t D = 5;
+    while (true) {
+        uint64_t a = (D < 0) ? -D : D;
+        int32_t j = jacobi64(bins_mod_1(n.bins.data(), n.bins.size(), (bin_t) a), a);
+        // reciprocity: (a / n) = (n / a), unless a and n are both 3 mod 4; and (-1 / n) = -1 for n = 3 mod 4
+        if (a % 4 == 3 && n.bins[0] % 4 == 3)
+            j = -j;
+        if (D < 0 && n.bins[0] % 4 == 3)
+            j = -j;
+        if (j == -1)
+            break;
+        if (j == 0)
+            return false;       // a divides n, and n > 2^64 > a
+        D = (D < 0) ? 2 - D : -2 - D;
+    }
+
+    Int e = n + Int(1);
+    s = trailing_zeros(e.bins.data());
+    e.shift_right(s);
+    return strong_lucas(n, mc, D, e.bins.data(), e.bins.size(), s);
+}
+
+/* Bytes in a sieve segment (one per odd number), to fit in the L1 cache */
+static const uint64_t SIEVE_SEGMENT = 1 << 15;
+
+/* sieve_odd - append to out the primes among the odd numbers in [lo, hi), for an odd lo,
+ *   crossing off multiples of the odd primes in base (which must reach sqrt(hi)) */
+static void sieve_odd(uint64_t lo, uint64_t hi, const std::vector<uint64_t>& base, std::vector<uint64_t>& out) {
+    std::vector<unsigned char> composite(SIEVE_SEGMENT);
+    uint64_t s = lo;
+    while (s < hi) {
+        uint64_t e = (hi - s > 2 * SIEVE_SEGMENT) ? s + 2 * SIEVE_SEGMENT : hi;
+        size_t count = (size_t) ((e - s + 1) / 2);      // s, s + 2, ..., below e
+        std::fill(composite.begin(), composite.begin() + count, 0);
+        for (size_t i = 0; i < base.size(); ++i) {
+            uint64_t p = base[i];
+            if (p * p >= e)
+                break;
+            // the first odd multiple of p from max(p^2, s)
+            uint64_t m = (p * p >= s) ? p * p : s + (p - s % p) % p;
+            if (m % 2 == 0) {
+                if (e - m <= p)
+                    continue;
+                m += p;
+            }
+            for (size_t j = (size_t) ((m - s) / 2); j < count; j += p)
+                composite[j] = 1;
+        }
+        for (size_t j = 0; j < count; ++j)
+            if (!composite[j])
+                out.push_back(s + 2 * j);
+        s = e;
+    }
+}
+
+/* primes_between - the primes in [lo, hi), in order */
+std::vector<uint64_t> primes_between(uint64_t lo, uint64_t hi, bool parallel) {
+    std::vector<uint64_t> primes;
+    if (lo <= 2 && hi > 2)
+        primes.push_back(2);
+    uint64_t start = (lo < 3) ? 3 : (lo | 1);
+    if (start >= hi)
+        return primes;
+
+    // the odd primes up to sqrt(hi - 1)
+    uint64_t root = (uint64_t) std::sqrt((double) (hi - 1));
+    while (root > 0 && root > (hi - 1) / root)
+        --root;
+    while ((root + 1) <= (hi - 1) / (root + 1))
+        ++root;
+    std::vector<uint64_t> base = (root >= 3) ? primes_between(3, root + 1) : std::vector<uint64_t>();
+
+    uint64_t segments = (hi - start + 2 * SIEVE_SEGMENT - 1) / (2 * SIEVE_SEGMENT);
+    uint64_t chunks = (parallel && PARALLEL_THREADS > 1) ? 4 * PARALLEL_THREADS : 1;
+    if (chunks > segments)
+        chunks = segments;
+    if (chunks < 2) {
+        sieve_odd(start, hi, base, primes);
+        return primes;
+    }
+
+    // whole segments per chunk, so every chunk starts on an odd number
+    std::vector<std::vector<uint64_t> > found(chunks);
+    std::vector<Task> tasks;
+    for (uint64_t c = 0; c < chunks; ++c) {
+        uint64_t a = start + segments * c / chunks * 2 * SIEVE_SEGMENT;
+        uint64_t b = (c + 1 == chunks) ? hi : start + segments * (c + 1) / chunks * 2 * SIEVE_SEGMENT;
+        std::vector<uint64_t>* out = &found[c];
+        tasks.push_back([a, b, &base, out] { sieve_odd(a, b, base, *out); });
+    }
+    parallel_run(tasks);
+    for (size_t c = 0; c < found.size(); ++c)
+        primes.insert(primes.end(), found[c].begin(), found[c].end());
+    return primes;
+}
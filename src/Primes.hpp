@@ -0,0 +1,33 @@
+#ifndef _PRIMES_HPP_
+#define _PRIMES_HPP_
+#include <vector>
+#include "Int.hpp"
+
+/* Primes - primality tests and prime generation (see Primes.cpp)
+ *   is_prime() is exact below 2^64 (Miller-Rabin with a fixed set of bases) and above
+ *   that is the Baillie-PSW test, for which no composite is known to pass. The Int
+ *   version is declared with Int (Int.hpp).
+ *
+ *   primes_between(lo, hi) lists the primes p with lo <= p < hi, in order, from a
+ *   segmented sieve. With parallel set, and PARALLEL_THREADS above 1 (Parallel.hpp),
+ *   the segments are shared out over threads.
+ */
+bool is_prime(uint64_t n);
+std::vector<uint64_t> primes_between(uint64_t lo, uint64_t hi, bool parallel = false);
+
+/* mulmod64 - a * b mod m, for a, b < m */
+inline uint64_t mulmod64(uint64_t a, uint64_t b, uint64_t m) {
+#if defined(__SIZEOF_INT128__)
+    return (uint64_t) ((unsigned __int128) a * b % m);
+#else
+    uint64_t r = 0;
+    for (; b > 0; b >>= 1) {
+        if (b & 1)
+            r = (r >= m - a) ? r - (m - a) : r + a;
+        a = (a >= m - a) ? a - (m - a) : a + a;
+    }
+    return r;
+#endif
+}
+
+#endif
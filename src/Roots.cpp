@@ -0,0 +1,114 @@
+#include <cmath>
+#include "Int.hpp"
+#include "BinOps.hpp"
+
+/* Roots.cpp - integer square roots, nth roots and perfect powers
+ *
+ * iroot(x, n) works from the top of x down, doubling the precision each time.
+ * The root of x's top half (in bits) gives the top half of the root, and that,
+ * rounded up, is an overestimate which Newton's iteration
+ *      r' = ((n - 1) r + x / r^(n - 1)) / n
+ * brings down to the exact root in one or two steps. Each level costs a power and
+ * one division of its own size, and the sizes halve, so the whole root costs about
+ * as much as a few full-size multiplications. Roots that fit in a bin start from
+ * the floating point root and are fixed up exactly.
+ */
+
+Int iroot(const Int& x, uint32_t n) {
+    if (n == 0)
+        throw std::domain_error("iroot: zeroth root");
+    if (x.negative) {
+        if (n % 2 == 0)
+            throw std::domain_error("iroot: even root of a negative number");
+        return -iroot(-x, n);
+    }
+    if (n == 1)
+        return x;
+
+    size_t bits = x.bit_length();
+    if (bits <= 1)
+        return x;           // 0 or 1
+    if (bits <= n)
+        return Int(1);      // x < 2^n
+    Int nth(n), n1(n - 1);
+
+    if ((bits + n - 1) / n <= Int::BIN_WIDTH) {
+        // the root fits in a bin; the top 64 bits of x give it to within one or two
+        Int top(x);
+        size_t dropped = (bits > 64) ? bits - 64 : 0;
+        top.shift_right(dropped);
+        uint64_t t = top.bins[0] | ((top.bins.size() > 1) ? (uint64_t) top.bins[1] << Int::BIN_WIDTH : 0);
+        double root = std::exp2((std::log2((double) t) + dropped) / n);   // x may overflow a double
+        int64_t r = (root >= 4294967295.0) ? 4294967295LL : (int64_t) root;
+        while (r > 0 && (Int(r) ^ nth) > x)
+            --r;
+        while ((Int(r + 1) ^ nth) <= x)
+            ++r;
+        return Int(r);
+    }
+
+    // root the top of x, which has about n * h fewer bits; that is the root's top half
+    size_t h = bits / (2 * n);
+    Int top(x);
+    top.shift_right(n * h);
+    Int r = iroot(top, n);
+    r.add_bin(1);
+    r.shift_left(h);        // > the root of x
+
+    Int p, next;
+    for (;;) {
+        exponentiate(r, n1, p);
+        next = x / p;
+        next += r * n1;
+        divide_by_int(next, n, next);
+        if (next >= r)
+            return r;
+        swap(r, next);
+    }
+}
+
+Int isqrt(const Int& x) {
+    return iroot(x, 2);
+}
+
+/* is_perfect_power - whether x = base^exp for some exp > 1
+ *   exp is the largest such exponent. It is found a prime at a time: whenever
+ *   x is an exact kth power, x is replaced by its kth root and k is tried again.
+ *   A prime that fails can't succeed later, since the exponent only loses factors,
+ *   and no prime above the bit length of x can work. 0 and 1 give (x, 2), and
+ *   -1 gives (-1, 3); a negative x only has odd exponents.
+ */
+bool is_perfect_power(const Int& x, Int& base, uint32_t& exp) {
+    Int b(x);
+    b.negative = false;
+    if (b.bit_length() <= 1) {
+        base = x;
+        exp = x.negative ? 3 : 2;
+        return true;
+    }
+
+    exp = 1;
+    for (uint32_t k = x.negative ? 3 : 2; k <= b.bit_length(); ++k) {
+        bool prime = true;
+        for (uint32_t d = 2; d * d <= k && prime; ++d)
+            prime = (k % d != 0);
+        if (!prime)
+            continue;
+        Int r = iroot(b, k);
+        while ((r ^ Int(k)) == b) {
+            swap(b, r);
+            exp *= k;
+            r = iroot(b, k);
+        }
+    }
+    if (exp == 1)
+        return false;
+    base = x.negative ? -b : b;
+    return true;
+}
+
+bool is_perfect_power(const Int& x) {
+    Int base;
+    uint32_t exp;
+    return is_perfect_power(x, base, exp);
+}
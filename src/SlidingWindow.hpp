@@ -0,0 +1,60 @@
+#ifndef _SLIDING_WINDOW_HPP_
+#define _SLIDING_WINDOW_HPP_
+#include "BinOps.hpp"
+
+/* exp_bit - bit i of e */
+static inline bin_t exp_bit(const bin_t* e, size_t i) {
+    return (e[i / BINOPS_BITS] >> (i % BINOPS_BITS)) & 1;
+}
+
+/* sliding_window_power - raise to the power e[0..en) by a left-to-right sliding window
+ *   This is the bit scanning shared by exponentiate() and powmod(). The odd powers
+ *   base, base^3, ..., base^(2^k - 1) are made first; then for each run of up to k
+ *   bits of e that starts and ends with a one, the result is squared once per bit
+ *   and multiplied by the matching odd power. Zero bits between runs are just squares.
+ *   The window size k grows with the length of e.
+ *
+ *   P does the arithmetic:
+ *      p.odd_powers(count) - make base^(2j + 1) for 0 <= j < count
+ *      p.start(j)          - set the result to base^(2j + 1)
+ *      p.square()          - square the result
+ *      p.multiply_by(j)    - multiply the result by base^(2j + 1)
+ *   e must not be zero.
+ */
+template <typename P>
+void sliding_window_power(const bin_t* e, size_t en, P& p) {
+    size_t nbits = en * BINOPS_BITS;
+    while (exp_bit(e, nbits - 1) == 0)
+        --nbits;
+
+    size_t k = (nbits > 671) ? 6 : (nbits > 239) ? 5 : (nbits > 79) ? 4 : (nbits > 23) ? 3 : (nbits > 7) ? 2 : 1;
+    p.odd_powers((size_t) 1 << (k - 1));
+
+    bool started = false;
+    size_t i = nbits;
+    while (i > 0) {
+        if (exp_bit(e, i - 1) == 0) {
+            p.square();
+            --i;
+            continue;
+        }
+        // the window is bits [j, i) of e, ending with the lowest one bit in reach
+        size_t j = (i > k) ? i - k : 0;
+        while (exp_bit(e, j) == 0)
+            ++j;
+        size_t val = 0;
+        for (size_t b = i; b > j; --b)
+            val = (val << 1) | exp_bit(e, b - 1);
+        if (!started) {
+            p.start(val >> 1);
+            started = true;
+        } else {
+            for (size_t b = j; b < i; ++b)
+                p.square();
+            p.multiply_by(val >> 1);
+        }
+        i = j;
+    }
+}
+
+#endif
@@ -13,10 +13,13 @@ const bool DEBUG_FRAC = false;
 #include <climits>
 #if INT_MAX == 2147483647
     typedef int int32_t;
+    typedef unsigned int uint32_t;
 #elif LONG_MAX == 2147483647
     typedef long int32_t;
+    typedef unsigned long uint32_t;
 #elif SHRT_MAX == 2147483647
     typedef short int32_t;
+    typedef unsigned short uint32_t;
 #else
 #error "Cannot find 32 bit integer"
 #endif
@@ -24,12 +27,39 @@ const bool DEBUG_FRAC = false;
 
 #if LONG_MAX == 9223372036854775807
     typedef long int64_t;
+    typedef unsigned long uint64_t;
 #elif LLONG_MAX == 9223372036854775807
     typedef long long int64_t;
+    typedef unsigned long long uint64_t;
 #else
 #error "Cannot find 64 bit integer"
 #endif
 
+/* Checked 64-bit arithmetic: r = a op b, returning true if that overflowed (r is then garbage) */
+#if defined(__GNUC__) || defined(__clang__)
+inline bool add_overflows(int64_t a, int64_t b, int64_t& r) { return __builtin_add_overflow(a, b, &r); }
+inline bool mul_overflows(int64_t a, int64_t b, int64_t& r) { return __builtin_mul_overflow(a, b, &r); }
+#else
+const int64_t INT64_MAX_VALUE = 9223372036854775807LL;
+const int64_t INT64_MIN_VALUE = -INT64_MAX_VALUE - 1;
+inline bool add_overflows(int64_t a, int64_t b, int64_t& r) {
+    if ((b > 0 && a > INT64_MAX_VALUE - b) || (b < 0 && a < INT64_MIN_VALUE - b))
+        return true;
+    r = a + b;
+    return false;
+}
+inline bool mul_overflows(int64_t a, int64_t b, int64_t& r) {
+    if (a != 0 && b != 0) {
+        int64_t lim = ((a < 0) == (b < 0)) ? INT64_MAX_VALUE : INT64_MIN_VALUE;
+        if ((a > 0) ? ((b > 0) ? b > lim / a : b < lim / a)
+                    : ((b > 0) ? a < lim / b : (a == INT64_MIN_VALUE || b < lim / a)))
+            return true;
+    }
+    r = a * b;
+    return false;
+}
+#endif
+
 const double EPSILON = 0.00001;
 
 struct divide_by_zero_error : public std::domain_error {
@@ -4,6 +4,12 @@
 #include <UnitTest++.h>
 #include <cassert>
 #include "../src/Int.hpp"
+#include "../src/IntExpr.hpp"
+#include "../src/Modular.hpp"
+#include "../src/BinOps.hpp"
+#include "../src/Parallel.hpp"
+#include "../src/Primes.hpp"
+#include "../src/Factor.hpp"
 #include "../src/common.hpp"
 
 using std::cout;
@@ -11,6 +17,27 @@ using std::endl;
 
 namespace IntTest {
 
+/* make a number with num_digits pseudo-random digits (deterministic for a given seed) */
+Int randomInt(size_t num_digits, unsigned seed) {
+    std::string s(num_digits, '0');
+    s[0] = '1' + seed % 9;
+    for (size_t i = 1; i < num_digits; ++i) {
+        seed = seed * 1103515245 + 12345;
+        s[i] = '0' + (seed >> 16) % 10;
+    }
+    return Int(s);
+}
+
+/* ThresholdGuard - changes a tunable (a threshold or thread count) for the rest of the
+ * scope, and puts the old value back even if a check throws */
+struct ThresholdGuard {
+    size_t& v;
+    size_t old;
+    explicit ThresholdGuard(size_t& v) : v(v), old(v) { }
+    ThresholdGuard(size_t& v, size_t value) : v(v), old(v) { v = value; }
+    ~ThresholdGuard() { v = old; }
+};
+
 bool runLessThan(const Int& x, const Int& y, bool expected) {
     bool lt = (x < y);
     bool result = (lt == expected); 
@@ -162,10 +189,10 @@ bool runTimesPowerTen(const Int& x, int32_t power, const Int& expected) {
 }
 
 bool runQuotientAndRemainder(const Int& y, const Int& x, int32_t q_expect, const Int& r_expect) {
-    int32_t q;
+    Int::bin_t q;
     Int r;
     quotient_and_remainder(y, x, q, r);
-    bool result = (q == q_expect && r == r_expect);
+    bool result = (q == (Int::bin_t) q_expect && r == r_expect);
     if (!result) {
         cout << "FAILED: q_and_r(" << y << ", " << x
              << ") --> (q=" << q << ", r=" << r << ") : "
@@ -260,12 +287,12 @@ TEST(printInt) {
     CHECK_THROW(Int(""), std::invalid_argument);
 
     // check other constructors
-    CHECK(testOutput(Int(9999, 2), "9999000000000000000000"));
+    CHECK(testOutput(Int(9999, 2), "184448993993021806608384"));  // 9999 * 2^64
 
     assert(sizeof(int64_t) == 8);
     int64_t k = 1234567891234567;
     CHECK(testOutput(Int(k), "1234567891234567"));
-    CHECK(testOutput(Int(k, 2), "1234567891234567000000000000000000"));
+    CHECK(testOutput(Int(k, 2), "22773757931223347102258590249910272"));
 
     // check things with many bins
     CHECK(testOutput(Int("152415787806666675432666675280250887626"), "152415787806666675432666675280250887626"));
@@ -916,6 +943,54 @@ TEST(modulus) {
                      Int("19493580213365553057812881012054202760537912221436")));
 }
 
+bool runDivmod(const Int& x, const Int& y, const Int& q_expect, const Int& r_expect) {
+    Int q, r;
+    divmod(x, y, q, r);
+    if (q != q_expect || r != r_expect) {
+        cout << "FAILED: divmod(" << x << ", " << y << ") = (" << q << ", " << r << ") : ("
+             << q_expect << ", " << r_expect << ")" << endl;
+        return false;
+    }
+    return true;
+}
+
+TEST(divmod) {
+    // floored: the remainder has the sign of the divisor
+    CHECK(runDivmod(Int(7),  Int(2),  Int(3),  Int(1)));
+    CHECK(runDivmod(Int(-7), Int(2),  Int(-4), Int(1)));
+    CHECK(runDivmod(Int(7),  Int(-2), Int(-4), Int(-1)));
+    CHECK(runDivmod(Int(-7), Int(-2), Int(3),  Int(-1)));
+    CHECK(runDivmod(Int(-6), Int(2),  Int(-3), Int(0)));
+    CHECK(runDivmod(Int(3),  Int(-8), Int(-1), Int(-5)));
+    CHECK(runDivmod(Int(0),  Int(-8), Int(0),  Int(0)));
+    CHECK(runDivmod(Int("-987654321987654321987654321"), Int("123456789123"),
+                    Int("-8000000072929601"), Int("49493875602")));
+    CHECK_THROW(runDivmod(Int(1), Int(0), Int(0), Int(0)), divide_by_zero_error);
+
+    // q * y + r == x for multi-bin operands of every sign
+    for (int i = 0; i < 4; ++i) {
+        Int x = randomInt(300, i + 1);
+        Int y = randomInt(120, i + 5);
+        if (i & 1) x.negate();
+        if (i & 2) y.negate();
+        Int q, r;
+        divmod(x, y, q, r);
+        CHECK(q * y + r == x);
+        CHECK(r.equals_int32(0) || r.is_negative() == y.is_negative());
+        CHECK(abs(r) < abs(y));
+        CHECK(r == x % y);
+    }
+
+    // the outputs may be the same instances as the inputs
+    Int a(-100), b(7);
+    divmod(a, b, a, b);
+    CHECK(a == Int(-15) && b == Int(5));
+    a = Int(100);
+    b = Int(7);
+    divmod(a, b, b, a);
+    CHECK(b == Int(14) && a == Int(2));
+}
+
 // negative exponents are handled elsewhere (than Int), since the result must be a fraction or decimal
 TEST(exponentiation) {
     // check (arg0 ^ arg1) == arg2
@@ -1022,6 +1097,747 @@ TEST(exponentiation) {
                                 "286320020820996952948736")));
 }
 
+TEST(binBoundaries) {
+    // carries and borrows across the 2^32 bin boundary
+    CHECK(runAddition(Int("4294967295"), Int(1), Int("4294967296")));
+    CHECK(runAddition(Int("79228162514264337593543950335"), Int(1), Int("79228162514264337593543950336")));
+    CHECK(runSubtraction(Int("79228162514264337593543950336"), Int(1), Int("79228162514264337593543950335")));
+    CHECK(runMultiplication(Int("18446744073709551615"), Int("18446744073709551615"),
+                            Int("340282366920938463426481119284349108225")));
+    CHECK(runDivision(Int("340282366920938463463374607431768211456"), Int("4294967295"),
+                      Int("79228162532711081671548469249")));
+    CHECK(testOutput(Int(std::numeric_limits<int64_t>::min()), "-9223372036854775808"));
+}
+
+TEST(karatsubaMultiplication) {
+    // Karatsuba (with a tiny threshold to force deep recursion) must agree with schoolbook
+    {
+        ThresholdGuard karatsuba(KARATSUBA_THRESHOLD);
+        const size_t sizes[] = { 40, 97, 300, 1000, 2500 };
+        for (size_t i = 0; i < 5; ++i) {
+            for (size_t j = 0; j <= i; ++j) {
+                Int x = randomInt(sizes[i], i + 1);
+                Int y = -randomInt(sizes[j], j + 50);
+                KARATSUBA_THRESHOLD = 1000000;
+                Int expected = x * y;
+                KARATSUBA_THRESHOLD = 4;
+                CHECK(runMultiplication(x, y, expected));
+                CHECK(runMultiplication(y, x, expected));
+                CHECK(runMultiplication(x, x, expected / y * x));
+            }
+        }
+    }
+
+    // sums of halves that carry into an extra bin
+    Int all_ones = Int(1, 40) - Int(1);  // 2^1280 - 1
+    CHECK(runMultiplication(all_ones, all_ones, Int(1, 80) - Int(2, 40) + Int(1)));
+}
+
+TEST(toomMultiplication) {
+    // Toom-3 and Toom-4 (with tiny thresholds to force deep recursion) must agree with schoolbook
+    ThresholdGuard toom3(TOOM3_THRESHOLD), toom4(TOOM4_THRESHOLD);
+    {
+        ThresholdGuard karatsuba(KARATSUBA_THRESHOLD);
+        const size_t sizes[] = { 90, 250, 777, 2000, 3000 };
+        for (size_t i = 0; i < 5; ++i) {
+            for (size_t j = 0; j <= i; ++j) {
+                Int x = randomInt(sizes[i], i + 7);
+                Int y = -randomInt(sizes[j], j + 70);
+                KARATSUBA_THRESHOLD = TOOM3_THRESHOLD = TOOM4_THRESHOLD = 1000000;
+                Int expected = x * y;
+                Int expected_sq = y * y;
+                KARATSUBA_THRESHOLD = 4;
+                TOOM3_THRESHOLD = 6;
+                CHECK(runMultiplication(x, y, expected));
+                CHECK(runMultiplication(y, y, expected_sq));
+                TOOM4_THRESHOLD = 8;
+                CHECK(runMultiplication(x, y, expected));
+                CHECK(runMultiplication(y, x, expected));
+                CHECK(runMultiplication(y, y, expected_sq));
+                TOOM3_THRESHOLD = TOOM4_THRESHOLD = 1000000;
+            }
+        }
+    }
+
+    // all-ones operands make every evaluated piece as big as it can be
+    TOOM3_THRESHOLD = 6;
+    TOOM4_THRESHOLD = 8;
+    Int all_ones = Int(1, 100) - Int(1);  // 2^3200 - 1
+    CHECK(runMultiplication(all_ones, all_ones, Int(1, 200) - Int(2, 100) + Int(1)));
+    CHECK(runExponentiation(all_ones + Int(1), Int(7), Int(1, 700)));
+}
+
+TEST(nttMultiplication) {
+    // NTT multiplication (forced on with a tiny threshold) must agree with schoolbook
+    ThresholdGuard karatsuba(KARATSUBA_THRESHOLD, 1000000), toom3(TOOM3_THRESHOLD, 1000000),
+                   toom4(TOOM4_THRESHOLD, 1000000), ntt(NTT_THRESHOLD, 1000000);
+    const size_t sizes[] = { 80, 333, 1500, 4000 };
+    for (size_t i = 0; i < 4; ++i) {
+        for (size_t j = 0; j <= i; ++j) {
+            Int x = randomInt(sizes[i], i + 17);
+            Int y = -randomInt(sizes[j], j + 71);
+            KARATSUBA_THRESHOLD = NTT_THRESHOLD = 1000000;
+            Int expected = x * y;
+            Int expected_sq = y * y;
+            KARATSUBA_THRESHOLD = 4;
+            NTT_THRESHOLD = 8;
+            CHECK(runMultiplication(x, y, expected));
+            CHECK(runMultiplication(y, x, expected));
+            CHECK(runMultiplication(y, y, expected_sq));
+        }
+    }
+
+    // all-ones operands give the largest possible convolution terms
+    NTT_THRESHOLD = 8;
+    Int all_ones = Int(1, 3000) - Int(1);  // 2^96000 - 1
+    CHECK(runMultiplication(all_ones, all_ones, Int(1, 6000) - Int(2, 3000) + Int(1)));
+    CHECK(runMultiplication(all_ones, Int(-1), -all_ones));
+}
+
+TEST(parallelMultiplication) {
+    // each algorithm, split over threads down to tiny products, must agree with one thread
+    ThresholdGuard karatsuba(KARATSUBA_THRESHOLD), toom3(TOOM3_THRESHOLD), toom4(TOOM4_THRESHOLD),
+                   ntt(NTT_THRESHOLD), split(MUL_PARALLEL_THRESHOLD), threads(PARALLEL_THREADS);
+    const size_t tiers[][4] = { { 4, 1000000, 1000000, 1000000 },       // Karatsuba
+                                { 4, 10, 1000000, 1000000 },            // Toom-3
+                                { 4, 10, 20, 1000000 },                 // Toom-4
+                                { 4, 10, 20, 30 } };                    // NTT
+    const size_t sizes[] = { 300, 3000, 45000 };     // the last for NTT stages big enough to split
+    for (size_t t = 0; t < 4; ++t) {
+        KARATSUBA_THRESHOLD = tiers[t][0];
+        TOOM3_THRESHOLD = tiers[t][1];
+        TOOM4_THRESHOLD = tiers[t][2];
+        NTT_THRESHOLD = tiers[t][3];
+        for (size_t i = 0; i < ((t == 3) ? 3u : 2u); ++i) {
+            Int x = randomInt(sizes[i], i + 5);
+            Int y = -randomInt(sizes[i] - 7 * i, i + 55);
+            PARALLEL_THREADS = 1;
+            Int expected = x * y, expected_sq = x * x;
+            PARALLEL_THREADS = 4;
+            MUL_PARALLEL_THRESHOLD = 16;
+            CHECK(runMultiplication(x, y, expected));
+            CHECK(runMultiplication(x, x, expected_sq));
+        }
+    }
+}
+
+TEST(longDivision) {
+    // q * y + r == x with 0 <= r < |y|, for multi-bin divisors of many shapes
+    const size_t sizes[] = { 20, 45, 100, 400, 1500 };
+    for (size_t i = 0; i < 5; ++i) {
+        for (size_t j = 0; j <= i; ++j) {
+            Int x = randomInt(sizes[i], i + 3);
+            Int y = randomInt(sizes[j], j + 30);
+            Int q = x / y;
+            Int r = x - q * y;
+            CHECK(!r.is_negative() && r < y);
+            CHECK(runDivision(-x, y, -q));
+            CHECK(runDivision(x * y + r, y, x));
+        }
+    }
+
+    // divisors whose top bins make the first quotient estimate too big
+    Int b = Int(1, 1);                          // 2^32
+    Int y = Int(1, 3) - Int(1, 1) + Int(1);     // bins {1, 0xffffffff, 0xffffffff}
+    Int x = y * (b - Int(1)) + y - Int(1);
+    CHECK(runDivision(x, y, b - Int(1)));
+    y = Int(1, 2) + Int(1);                     // 2^64 + 1: top bin 1, needs the full shift
+    x = Int(1, 6) - Int(1);
+    CHECK(runDivision(x, y, Int("340282366920938463444927863358058659840")));
+    CHECK(runDivision(y * y, y, y));
+    CHECK(runDivision(y * y - Int(1), y, y - Int(1)));
+}
+
+TEST(recursiveDivision) {
+    // recursive division (forced on with a tiny threshold) must agree with schoolbook
+    ThresholdGuard div_dc(DIV_DC_THRESHOLD);
+    const size_t sizes[] = { 50, 130, 700, 3000, 6000 };
+    for (size_t i = 0; i < 5; ++i) {
+        for (size_t j = 0; j <= i; ++j) {
+            Int x = randomInt(sizes[i], i + 11);
+            Int y = -randomInt(sizes[j], j + 13);
+            DIV_DC_THRESHOLD = 1000000;
+            Int expected = x / y;
+            Int expected_mod = x % y;
+            DIV_DC_THRESHOLD = 4;
+            CHECK(runDivision(x, y, expected));
+            CHECK(runModulus(x, y, expected_mod));
+            CHECK(runDivision(x * y - Int(1), y, x));
+        }
+    }
+
+    // all-ones operands force the most quotient corrections
+    Int all_ones = Int(1, 300) - Int(1);  // 2^9600 - 1
+    Int y = Int(1, 100) - Int(1);
+    CHECK(runDivision(all_ones, y, Int(1, 200) + Int(1, 100) + Int(1)));
+    CHECK(runDivision(all_ones * all_ones, all_ones, all_ones));
+    CHECK(runDivision(all_ones * all_ones - Int(1), all_ones, all_ones - Int(1)));
+}
+
+TEST(decimalConversion) {
+    // the recursive conversion (forced on with a tiny threshold) must agree with the basecase
+    ThresholdGuard radix(Int::RADIX_THRESHOLD);
+    const size_t sizes[] = { 1, 9, 10, 18, 19, 100, 1000, 5000, 20000 };
+    for (size_t i = 0; i < 9; ++i) {
+        std::string s(sizes[i], '0');
+        for (size_t j = 0; j < s.size(); ++j)
+            s[j] = '0' + (j * 7 + i) % 10;
+        s[0] = '1' + i % 9;
+        if (s.size() > 2)
+            s[s.size() / 2] = '0';  // runs of zeros must survive the padding
+        Int::RADIX_THRESHOLD = 1000000;
+        Int expected(s);
+        Int::RADIX_THRESHOLD = 3;
+        Int x(s);
+        CHECK(x == expected);
+        CHECK(x.to_string() == s);
+        CHECK(testOutput(-x, "-" + s));
+        CHECK(Int::from_string("-" + s) == -expected);
+    }
+
+    // powers of ten put zeros on every boundary of the split
+    Int p = Int(10) ^ Int(2000);
+    CHECK((p - Int(1)).to_string() == std::string(2000, '9'));
+    CHECK(p.to_string() == "1" + std::string(2000, '0'));
+    CHECK((p + Int(1)).to_string() == "1" + std::string(1999, '0') + "1");
+    Int::RADIX_THRESHOLD = radix.old;
+    CHECK(Int(0).to_string() == "0");
+}
+
+TEST(swapInts) {
+    // small values are stored inline, large values on the heap; swap must handle every mix
+    Int small(-12345);
+    Int big("123456789123456789123456789123456789123456789123456789");
+    Int big2("-987654321987654321987654321987654321987654321987654321");
+    swap(small, big);
+    CHECK(testOutput(small, "123456789123456789123456789123456789123456789123456789"));
+    CHECK(testOutput(big, "-12345"));
+    swap(small, big2);
+    CHECK(testOutput(small, "-987654321987654321987654321987654321987654321987654321"));
+    CHECK(testOutput(big2, "123456789123456789123456789123456789123456789123456789"));
+    Int a(1), b(2);
+    swap(a, b);
+    CHECK(a == Int(2) && b == Int(1));
+}
+
+static size_t heap_copies = 0;
+static void count_heap_copy(size_t) { ++heap_copies; }
+
+TEST(moveSemantics) {
+    Int a = randomInt(200, 1), b = randomInt(150, 2), c = randomInt(180, 3), d = randomInt(90, 4);
+    Int ab = a * b, cd = c * d;
+    Int expected = ab + cd, neg_expected = -expected, qr = a / b + c % d;
+
+    // the products are temporaries, so the sum is built in one of them
+    Int::bins_t::heap_copy_hook = count_heap_copy;
+    size_t copies = heap_copies;
+    Int r = a * b + c * d;
+    CHECK(r == expected);
+    CHECK(-(a * b) - c * d == neg_expected);
+    CHECK(Int(a) / b + Int(c) % d == qr);
+    CHECK_EQUAL(2u, heap_copies - copies);     // just the two explicit Int(...)
+
+    // a moved-from Int is zero, and moving leaves the bins alone
+    Int moved(std::move(r));
+    CHECK(moved == expected && r.equals_int32(0));
+    r = std::move(moved);
+    CHECK(r == expected && moved.equals_int32(0));
+    CHECK_EQUAL(2u, heap_copies - copies);
+    Int::bins_t::heap_copy_hook = NULL;
+
+    // every mix of signs and sizes, through each rvalue overload
+    Int vals[] = { a, -a, b, -b, Int(7), Int(-7), Int(0) };
+    for (size_t i = 0; i < 7; ++i) {
+        for (size_t j = 0; j < 7; ++j) {
+            const Int& x = vals[i];
+            const Int& y = vals[j];
+            CHECK(Int(x) + y == x + y && x + Int(y) == x + y && Int(x) + Int(y) == x + y);
+            CHECK(Int(x) - y == x - y && x - Int(y) == x - y && Int(x) - Int(y) == x - y);
+            CHECK(-Int(x) == -x);
+            if (!y.equals_int32(0))
+                CHECK(Int(x) / y == x / y && Int(x) % y == x % y);
+        }
+    }
+
+    // compound operators with the same instance on both sides
+    Int x(c);
+    x -= x;
+    CHECK(x.equals_int32(0) && !x.is_negative());
+    x = -c;
+    x += x;
+    CHECK(x == -(c + c));
+    x /= x;
+    CHECK(x == Int(1));
+}
+
+TEST(fusedProducts) {
+    // small and Karatsuba-sized operands, with every mix of signs
+    Int a = randomInt(40, 5), b = randomInt(25, 6), c = randomInt(700, 7), d = randomInt(650, 8);
+    Int vals[] = { a, -a, b, -b, c, -c, d, Int(-3), Int(0) };
+    for (size_t i = 0; i < 9; ++i) {
+        for (size_t j = 0; j < 9; ++j) {
+            const Int& x = vals[i];
+            const Int& y = vals[j];
+            CHECK(Int(prod(x, y) + prod(y, b)) == x * y + y * b);
+            CHECK(Int(prod(x, y) - prod(c, x)) == x * y - c * x);
+            CHECK(Int(x - prod(y, a) + y) == x - y * a + y);
+            Int r(y);
+            r -= prod(x, c);
+            CHECK(r == y - x * c);
+            r += prod(x, d);
+            CHECK(r == y - x * c + x * d);
+
+            // temporary Ints on either side of a product
+            CHECK(Int((x + y) - prod(y, c)) == x + y - y * c);
+            CHECK(Int(prod(x, b) + Int(1) * y) == x * b + y);
+            CHECK(Int(prod(x, d) - (y - a)) == x * d - y + a);
+            CHECK(Int(Int(x) + prod(y, y) - prod(x, a)) == x + y * y - x * a);
+        }
+    }
+
+    // cancelling products give a positive zero
+    Int z = prod(a, b) - prod(b, a);
+    CHECK(z.equals_int32(0) && !z.is_negative());
+
+    // the destination may appear in the expression
+    Int r(a);
+    r += prod(r, b);
+    CHECK(r == a + a * b);
+    r -= prod(c, d) + prod(r, r);
+    CHECK(r == a + a * b - c * d - (a + a * b) * (a + a * b));
+}
+
+TEST(squaring) {
+    // x * x takes the squaring path; x * copy takes the general one
+    size_t sizes[] = { 1, 2, 3, 9, 10, 31, 32, 33, 100, 350, 1000 };
+    for (size_t i = 0; i < 11; ++i) {
+        Int x = randomInt(sizes[i] * 10, i + 90);
+        Int copy(x);
+        CHECK(x * x == x * copy);
+        x.negate();
+        CHECK(x * x == x * copy * Int(-1));
+    }
+    Int all_ones = Int(1, 40) - Int(1);  // 2^1280 - 1
+    CHECK(all_ones * all_ones == Int(1, 80) - Int(2, 40) + Int(1));
+}
+
+TEST(slidingWindowPower) {
+    // every window size, against repeated multiplication
+    Int x = randomInt(30, 11);
+    Int p(1);
+    for (int32_t e = 0; e <= 1100; ++e) {
+        if (e % 97 == 0 || e < 40)
+            CHECK(runExponentiation(x, Int(e), p));
+        p *= x;
+    }
+    CHECK(runExponentiation(-x, Int(37), -(x ^ Int(37))));
+    CHECK(runExponentiation(-x, Int(38), x ^ Int(38)));
+    CHECK(runExponentiation(Int(2), Int(4000), Int(1, 125)));
+    CHECK(runExponentiation(Int(0), Int(5), Int(0)));
+
+    // a negative exponent truncates like division
+    CHECK(runExponentiation(Int(7), Int(-2), Int(0)));
+    CHECK(runExponentiation(Int(1), Int(-3), Int(1)));
+    CHECK(runExponentiation(Int(-1), Int(-3), Int(-1)));
+    CHECK(runExponentiation(Int(-1), Int(-4), Int(1)));
+    CHECK_THROW(Int(0) ^ Int(-1), divide_by_zero_error);
+}
+
+TEST(powmod) {
+    // odd (Montgomery) and even moduli of various sizes, against the direct computation
+    Int mods[] = { Int(7), Int(10), Int(4294967291LL), Int(1, 1), randomInt(50, 21),
+                   randomInt(50, 21) + Int(1), randomInt(400, 22), randomInt(400, 22) + Int(1) };
+    Int bases[] = { Int(0), Int(1), Int(-3), randomInt(30, 23), -randomInt(120, 24) };
+    int32_t exps[] = { 0, 1, 2, 3, 17, 64, 101 };
+    for (size_t i = 0; i < 8; ++i)
+        for (size_t j = 0; j < 5; ++j)
+            for (size_t k = 0; k < 7; ++k)
+                CHECK(powmod(bases[j], Int(exps[k]), mods[i]) == (bases[j] ^ Int(exps[k])) % mods[i]);
+
+    // Fermat's little theorem with the Mersenne primes 2^127 - 1 and 2^521 - 1
+    Int p127 = (Int(2) ^ Int(127)) - Int(1);
+    Int p521 = (Int(2) ^ Int(521)) - Int(1);
+    CHECK(powmod(randomInt(60, 25), p127 - Int(1), p127) == Int(1));
+    CHECK(powmod(randomInt(200, 26), p521 - Int(1), p521) == Int(1));
+    CHECK(powmod(Int(3), p521, p521) == Int(3));
+
+    // a negative modulus gives a result with its sign, like %
+    CHECK(powmod(Int(3), Int(5), Int(-7)) == Int(243) % Int(-7));
+    CHECK(powmod(Int(5), Int(3), Int(1)) == Int(0));
+    CHECK_THROW(powmod(Int(3), Int(5), Int(0)), divide_by_zero_error);
+    CHECK_THROW(powmod(Int(3), Int(-5), Int(7)), std::domain_error);
+
+    // 2^32 is one in its top bin; it must not pass for a modulus of 1
+    CHECK(powmod(Int(3), Int(2), Int(1, 1)) == Int(9));
+    CHECK(!Int(1, 1).equals_int32(1) && !Int(-1, 2).equals_int32(-1));
+}
+
+TEST(modContext) {
+    // floored % gives the same [0, m) residues for a positive m
+    Int mods[] = { Int(2), Int(97), Int(4294967296LL), randomInt(40, 31), randomInt(300, 32) };
+    for (size_t i = 0; i < 5; ++i) {
+        ModContext ctx(mods[i]);
+        const Int& m = mods[i];
+        CHECK(ctx.modulus() == m);
+        Int vals[] = { Int(0), Int(1), m - Int(1), m, m + Int(1), randomInt(35, i + 33),
+                       -randomInt(70, i + 34), randomInt(650, i + 35), (m - Int(1)) * (m - Int(1)) };
+        for (size_t j = 0; j < 9; ++j) {
+            const Int& a = vals[j];
+            CHECK(ctx.reduce(a) == a % m);
+            for (size_t k = 0; k < 9; ++k) {
+                const Int& b = vals[k];
+                CHECK(ctx.mulmod(a, b) == (a * b) % m);
+                CHECK(ctx.addmod(a, b) == (a + b) % m);
+                CHECK(ctx.submod(a, b) == (a - b) % m);
+            }
+        }
+    }
+    CHECK_THROW(ModContext(Int(0)), divide_by_zero_error);
+    CHECK_THROW(ModContext(Int(-5)), std::domain_error);
+}
+
+TEST(roots) {
+    CHECK(isqrt(Int(0)) == Int(0) && isqrt(Int(1)) == Int(1) && isqrt(Int(3)) == Int(1));
+    CHECK(isqrt(Int(4)) == Int(2) && isqrt(Int(99)) == Int(9) && isqrt(Int(100)) == Int(10));
+    CHECK(iroot(Int(-27), 3) == Int(-3) && iroot(Int(-28), 3) == Int(-3));
+    CHECK(iroot(Int(1, 1), 64) == Int(1) && iroot(Int(12345), 1) == Int(12345));
+    CHECK_THROW(isqrt(Int(-4)), std::domain_error);
+    CHECK_THROW(iroot(Int(8), 0), std::domain_error);
+
+    // r = iroot(x, n) exactly when r^n <= x < (r + 1)^n, from one bin up to thousands
+    size_t sizes[] = { 5, 15, 20, 40, 100, 1000, 5000 };
+    uint32_t ns[] = { 2, 3, 5, 7, 32, 100 };
+    for (size_t i = 0; i < 7; ++i) {
+        Int x = randomInt(sizes[i], i + 40);
+        for (size_t j = 0; j < 6; ++j) {
+            Int r = iroot(x, ns[j]), n(ns[j]);
+            CHECK((r ^ n) <= x && x < ((r + Int(1)) ^ n));
+        }
+        // exact powers, and one less than them
+        Int sq = x * x;
+        CHECK(isqrt(sq) == x && isqrt(sq - Int(1)) == x - Int(1));
+        Int cube = sq * x;
+        CHECK(iroot(cube, 3) == x && iroot(cube - Int(1), 3) == x - Int(1));
+    }
+}
+
+TEST(perfectPowers) {
+    Int base;
+    uint32_t exp;
+    CHECK(is_perfect_power(Int(1, 3), base, exp) && base == Int(2) && exp == 96);
+    CHECK(is_perfect_power(Int(1000000), base, exp) && base == Int(10) && exp == 6);
+    CHECK(is_perfect_power(Int(-1000000), base, exp) && base == Int(-100) && exp == 3);
+    CHECK(is_perfect_power(Int(-32), base, exp) && base == Int(-2) && exp == 5);
+    CHECK(!is_perfect_power(Int(-64 * 4)) && !is_perfect_power(Int(2)) && !is_perfect_power(Int(12)));
+    Int x = randomInt(40, 45);
+    CHECK(is_perfect_power(x ^ Int(15), base, exp) && (base ^ Int(exp)) == (x ^ Int(15)) && exp % 15 == 0);
+    CHECK(!is_perfect_power((x ^ Int(15)) + Int(1)));
+    CHECK(is_perfect_power(Int(0)) && is_perfect_power(Int(1)) && is_perfect_power(Int(-1)));
+}
+
+TEST(gcd) {
+    CHECK(gcd(Int(0), Int(0)) == Int(0) && gcd(Int(-12), Int(0)) == Int(12) && gcd(Int(0), Int(7)) == Int(7));
+    CHECK(gcd(Int(-12), Int(18)) == Int(6) && gcd(Int(12), Int(-18)) == Int(6) && gcd(Int(17), Int(5)) == Int(1));
+    CHECK(gcd(Int("18446744073709551615"), Int("12297829382473034410")) == Int("6148914691236517205"));
+
+    // compare with Euclid's algorithm, over a spread of sizes and common factors
+    size_t sizes[] = { 5, 19, 20, 30, 60, 200, 1000 };
+    for (size_t i = 0; i < 7; ++i) {
+        for (size_t j = 0; j <= i; ++j) {
+            Int c = randomInt(sizes[j] / 2 + 1, i * 7 + j + 50);
+            Int a = randomInt(sizes[i], i * 7 + j + 51) * c;
+            Int b = randomInt(sizes[j], i * 7 + j + 52) * c;
+            Int x = a, y = b, q, r;
+            while (!y.equals_int32(0)) {
+                divmod(x, y, q, r);
+                swap(x, y);
+                swap(y, r);
+            }
+            CHECK(gcd(a, b) == x && gcd(b, -a) == x);
+        }
+    }
+    // a batch of one step from the top bits has A = 0
+    CHECK(gcd(randomInt(22, 22239), randomInt(239, 239027)) == Int(3));
+    CHECK(gcd(randomInt(64, 64078), randomInt(78, 78069)) == Int(1));
+    // consecutive Fibonacci numbers have all quotients 1
+    Int f0(0), f1(1);
+    for (size_t i = 0; i < 3000; ++i) {
+        f0 += f1;
+        swap(f0, f1);
+    }
+    CHECK(gcd(f1, f0) == Int(1) && gcd(f1 * f0, f0 * f0) == f0);
+}
+
+TEST(xgcd) {
+    Int g, s, t;
+    xgcd(Int(240), Int(46), g, s, t);
+    CHECK(g == Int(2) && s == Int(-9) && t == Int(47));
+    xgcd(Int(-12), Int(0), g, s, t);
+    CHECK(g == Int(12) && s == Int(-1) && t == Int(0));
+    xgcd(Int(0), Int(0), g, s, t);
+    CHECK(g == Int(0) && s == Int(0) && t == Int(0));
+
+    size_t sizes[] = { 3, 19, 20, 45, 200, 1000 };
+    for (size_t i = 0; i < 6; ++i) {
+        for (size_t j = 0; j < 6; ++j) {
+            Int c = randomInt(sizes[j] / 3 + 1, i * 7 + j + 80);
+            Int x = randomInt(sizes[i], i * 7 + j + 81) * c;
+            Int y = randomInt(sizes[j], i * 7 + j + 82) * c;
+            if (j % 2 == 1)
+                x = -x;
+            xgcd(x, y, g, s, t);
+            CHECK(g == gcd(x, y) && s * x + t * y == g);
+            CHECK(abs(s) * g * Int(2) <= abs(y) && abs(t) * g * Int(2) <= abs(x));
+        }
+    }
+}
+
+TEST(invmod) {
+    CHECK(invmod(Int(3), Int(7)) == Int(5) && invmod(Int(-3), Int(7)) == Int(2));
+    CHECK(invmod(Int(3), Int(-7)) == Int(-2) && invmod(Int(5), Int(1)) == Int(0));
+    CHECK_THROW(invmod(Int(6), Int(9)), std::domain_error);
+    CHECK_THROW(invmod(Int(6), Int(0)), divide_by_zero_error);
+
+    Int m = (Int(1, 40) * Int(3)) + Int(1);
+    for (size_t i = 0; i < 20; ++i) {
+        Int a = randomInt(10 + i * 40, i + 90);
+        if (gcd(a, m).equals_int32(1)) {
+            Int inv = invmod(a, m);
+            CHECK((a * inv) % m == Int(1) && Int(0) <= inv && inv < m);
+        } else {
+            CHECK_THROW(invmod(a, m), std::domain_error);
+        }
+    }
+}
+
+TEST(factorialAndBinomial) {
+    Int f(1);
+    for (uint32_t n = 0; n <= 300; ++n) {
+        if (n > 1)
+            f *= Int(n);
+        CHECK(factorial(n) == f);
+    }
+    CHECK(testOutput(factorial(25), "15511210043330985984000000"));
+
+    // Pascal's rule, through both the prime-power and the short-product cases
+    for (uint32_t n = 1; n < 400; n += 13) {
+        for (uint32_t k = 1; k <= n; k += 3) {
+            CHECK(binomial(n, k) == binomial(n - 1, k - 1) + binomial(n - 1, k));
+            CHECK(binomial(n, k) == binomial(n, n - k));
+        }
+        CHECK(binomial(n, n + 1) == Int(0) && binomial(n, 0) == Int(1));
+    }
+    CHECK(binomial(3000, 1500) == factorial(3000) / (factorial(1500) * factorial(1500)));
+    CHECK(testOutput(binomial(4000000000u, 2), "7999999998000000000"));
+
+    std::vector<uint32_t> parts;
+    parts.push_back(700);
+    parts.push_back(5);
+    parts.push_back(300);
+    parts.push_back(0);
+    CHECK(multinomial(parts) == binomial(1005, 700) * binomial(305, 5));
+    parts[0] = 100000;
+    CHECK(multinomial(parts) == binomial(100305, 300) * binomial(100005, 5));
+    parts.push_back(0xFFFFFFFFu);
+    CHECK_THROW(multinomial(parts), std::domain_error);
+}
+
+TEST(primality) {
+    // the 64-bit test against the sieve, and the sieve against itself
+    std::vector<uint64_t> ps = primes_between(0, 100000);
+    CHECK(ps.size() == 9592);
+    size_t k = 0;
+    bool agree = true;
+    for (uint64_t i = 0; i < 100000; ++i) {
+        bool p = k < ps.size() && ps[k] == i;
+        k += p;
+        agree = agree && (p == is_prime(i));
+    }
+    CHECK(agree);
+    CHECK(primes_between(0, 1000000).size() == 78498);
+    CHECK(primes_between(0, 2).empty() && primes_between(2, 3).size() == 1 && primes_between(24, 29).empty());
+    uint64_t lo = 1000000000000ULL;
+    std::vector<uint64_t> window = primes_between(lo, lo + 100000);
+    k = 0;
+    for (uint64_t i = lo; i < lo + 100000; ++i)
+        if (is_prime(i))
+            agree = agree && k < window.size() && window[k++] == i;
+    CHECK(agree && k == window.size());
+    {
+        ThresholdGuard threads(PARALLEL_THREADS, 4);
+        CHECK(primes_between(lo, lo + 1000000, true) == primes_between(lo, lo + 1000000));
+    }
+
+    // strong pseudoprimes to several bases, and primes near 2^64
+    CHECK(!is_prime((uint64_t) 3215031751ULL) && !is_prime((uint64_t) 2152302898747ULL));
+    CHECK(!is_prime((uint64_t) 3825123056546413051ULL));
+    CHECK(is_prime((uint64_t) 18446744073709551557ULL) && !is_prime((uint64_t) 18446744073709551615ULL));
+
+    // past 64 bits: Mersenne primes and composites, a Fermat number, squares, semiprimes
+    Int two(2), one(1);
+    CHECK(is_prime((two ^ Int(89)) - one) && is_prime((two ^ Int(127)) - one) && is_prime((two ^ Int(521)) - one));
+    CHECK(!is_prime((two ^ Int(67)) - one) && !is_prime((two ^ Int(128)) + one));
+    Int p("18446744073709551629"), q((two ^ Int(127)) - one);
+    CHECK(is_prime(p) && !is_prime(p * p) && !is_prime(p * q) && !is_prime(q * q * q));
+    CHECK(!is_prime(Int("318665857834031151167461")));     // a strong pseudoprime to the first 12 prime bases
+    CHECK(!is_prime(-p) && !is_prime(Int(0)) && !is_prime(Int(1)) && is_prime(Int(2)));
+}
+
+TEST(factorization) {
+    // every factorization multiplies back, into primes
+    bool ok = true;
+    for (int64_t n = 1; n < 3000; ++n) {
+        Factorization f = factor(Int(n));
+        Int back(1);
+        for (size_t i = 0; i < f.primes.size(); ++i) {
+            ok = ok && is_prime(f.primes[i].first) && (i == 0 || f.primes[i - 1].first < f.primes[i].first);
+            back *= f.primes[i].first ^ Int(f.primes[i].second);
+        }
+        ok = ok && f.complete() && back == Int(n);
+    }
+    CHECK(ok);
+
+    Factorization f = factor(Int(-360));
+    CHECK(f.primes.size() == 3 && f.primes[0].first == Int(2) && f.primes[0].second == 3 && f.primes[2].second == 1);
+    CHECK(factor(Int(1)).primes.empty() && factor(Int(-1)).complete());
+    CHECK_THROW(factor(Int(0)), std::domain_error);
+
+    // rho below 2^64, rho on Ints, powers, and ECM with rho turned off
+    f = factor(Int(4294967291LL) * Int(4294967279LL));
+    CHECK(f.primes.size() == 2 && f.primes[0].first == Int(4294967279LL));
+    Int p("1000000000000000000000000000057"), q(1000000007);
+    f = factor(p * q * q * Int(360));
+    CHECK(f.complete() && f.primes.size() == 5 && f.primes[3].first == q && f.primes[3].second == 2 && f.primes[4].first == p);
+    f = factor((p * q) ^ Int(3));
+    CHECK(f.primes.size() == 2 && f.primes[0].second == 3 && f.primes[1].second == 3);
+    FactorBudget ecm_only;
+    ecm_only.rho_steps = 0;
+    f = factor(Int("10000000019") * Int("1000000000039") * p, ecm_only);
+    CHECK(f.complete() && f.primes.size() == 3 && f.primes[1].first == Int("1000000000039"));
+    Int two(2);
+    f = factor((two ^ Int(128)) - Int(1), ecm_only);
+    CHECK(f.complete() && f.primes.size() == 9 && f.primes[8].first == Int("67280421310721"));
+
+    // when the budget runs out, what's left is handed back whole
+    FactorBudget small;
+    small.rho_steps = 1000;
+    small.ecm_curves = 2;
+    Int hard = Int("100000000000000000039") * Int("1000000000000000000117");
+    f = factor(hard * Int(12), small);
+    CHECK(!f.complete() && f.unfactored.size() == 1 && f.unfactored[0].first == hard && f.primes.size() == 2);
+    CHECK(FactorBudget().milliseconds > 0);     // the default is bounded in time too
+    FactorBudget brief;
+    brief.milliseconds = 20;
+    f = factor(hard * Int(360), brief);
+    CHECK(f.primes.size() == 3 && f.unfactored.size() == 1 && f.unfactored[0].first == hard);
+}
+
+TEST(productTree) {
+    std::vector<Int> xs;
+    CHECK(product(xs) == Int(1));
+    Int folded(1);
+    for (size_t i = 0; i < 300; ++i) {
+        xs.push_back((i % 7 == 3) ? -randomInt(1 + i * 11 % 400, i + 1) : randomInt(1 + i % 9, i + 1));
+        folded *= xs.back();
+    }
+    CHECK(product(xs) == folded);
+
+    {
+        ThresholdGuard threads(PARALLEL_THREADS, 4);
+        CHECK(product(xs, true) == folded);
+    }
+
+    xs.push_back(Int(0));
+    CHECK(product(xs) == Int(0));
+}
+
+TEST(multiplyAssignZero) {
+    // a zero product is never negative, whichever side is big or negative
+    Int x("-123456789012345678901234567890");
+    x *= Int(0);
+    CHECK(x.equals_int32(0) && !x.is_negative() && testOutput(x, "0"));
+    Int z(0);
+    z *= Int("-123456789012345678901234567890");
+    CHECK(z.equals_int32(0) && !z.is_negative() && testOutput(z, "0"));
+    Int y("-98765432109876543210987654321");
+    y *= Int("-123456789012345678901234567890");
+    CHECK(y == Int("98765432109876543210987654321") * Int("123456789012345678901234567890"));
+}
+
+TEST(smallValueOverflow) {
+    // results just past 64 bits must spill over into the bins
+    Int big("9223372036854775807"), one(1), two(2);
+    CHECK(testOutput(big + one, "9223372036854775808"));
+    CHECK(testOutput(-big - one, "-9223372036854775808"));
+    CHECK(testOutput(-big - two, "-9223372036854775809"));
+    CHECK(testOutput(big * two, "18446744073709551614"));
+    CHECK(testOutput(Int("-4294967296") * Int("2147483648"), "-9223372036854775808"));
+    CHECK(testOutput(Int("4294967296") * Int("4294967296"), "18446744073709551616"));
+    Int x(big);
+    x += big;
+    CHECK(testOutput(x, "18446744073709551614"));
+    x -= big;
+    CHECK(x == big);
+    x *= Int(-3);
+    CHECK(testOutput(x, "-27670116110564327421"));
+    CHECK(big > -big && -big < big && Int(-5) < Int(3) && !(Int(3) < Int(3)));
+
+    // small division floors like the long one
+    int64_t xs[] = { 7, -7, 0, 123456789012345LL, -123456789012345LL };
+    int64_t ys[] = { 2, -2, 3, -1000000007LL };
+    for (size_t i = 0; i < 5; ++i) {
+        for (size_t j = 0; j < 4; ++j) {
+            Int q, r;
+            divmod(Int(xs[i]), Int(ys[j]), q, r);
+            CHECK(q * Int(ys[j]) + r == Int(xs[i]) && abs(r) < abs(Int(ys[j])));
+            CHECK(r.equals_int32(0) || r.is_negative() == (ys[j] < 0));
+            CHECK(Int(xs[i]) / Int(ys[j]) == Int(xs[i] / ys[j]));
+        }
+    }
+}
+
+TEST(longCarryChains) {
+    // runs of all-one and zero bins carry and borrow across whole blocks of bins
+    for (size_t n = 1; n < 70; n += 3) {
+        Int ones = Int(1, n) - Int(1);              // n bins of 0xFFFFFFFF
+        CHECK(ones + Int(1) == Int(1, n) && Int(1, n) - Int(1) == ones);
+        CHECK(ones + ones == ones * Int(2) && (ones + ones) - ones == ones);
+        Int x = randomInt(10 * n + 1, n + 100);
+        Int y = Int(x, n) + ones;                   // x, then n bins of ones
+        CHECK(y + Int(1) == Int(x + Int(1), n) && y - ones == Int(x, n));
+        CHECK(y + y == y * Int(2) && (y + x) - x == y && (x - y) + y == x);
+        CHECK(y > Int(x, n) && Int(x, n) < y && y - Int(1) < y && !(y < y));
+        Int z = Int(x, n) + Int(1);
+        CHECK(z - Int(2) == Int(x - Int(1), n) + ones);
+    }
+}
+
+TEST(binPool) {
+    // a loop of same-sized temporaries reuses the arrays it frees
+    Int x = randomInt(600, 7), y = randomInt(500, 8), acc;
+    Int::bins_t::reset_pool_stats();
+    for (size_t i = 0; i < 200; ++i) {
+        Int p = x * y;
+        Int q = p / x;
+        CHECK(q == y);
+        acc = p - acc;
+    }
+    BinPoolStats st = Int::bins_t::pool_stats();
+    CHECK(st.pooled > 100 * st.heap);
+    CHECK(acc == Int(0) || acc == x * y);
+
+    // big arrays go back to the allocator, and the pool stays under its cap
+    Int big(1);
+    big.shift_left((size_t) 1 << 26);        // 2^21 bins, 8MB
+    size_t before = Int::bins_t::pool_stats().cached;
+    {
+        Int copy(big);
+        CHECK(copy == big);
+    }
+    CHECK_EQUAL(before, Int::bins_t::pool_stats().cached);
+    CHECK(Int::bins_t::pool_stats().cached <= BinPool<Int::bin_t>::MAX_CACHED_BYTES);
+}
+
 TEST(timesPowerTen) {
     CHECK(runTimesPowerTen(Int(2),  0, Int("2")));
     CHECK(runTimesPowerTen(Int(2),  1, Int("20")));
@@ -1128,4 +1944,29 @@ TEST(inStream) {
     }
 }
 
+TEST(parseRange) {
+    Int x;
+    const char* csv = "123,-4567,00089,-0,98765432109876543210";
+    CHECK(x.parse(csv, csv + 3) && testOutput(x, "123"));
+    CHECK(x.parse(csv + 4, csv + 9) && testOutput(x, "-4567"));
+    CHECK(x.parse(csv + 10, 5) && testOutput(x, "89"));
+    CHECK(x.parse(csv + 16, 2) && testOutput(x, "0") && !x.is_negative());
+    CHECK(x.parse(csv + 19, csv + 39) && testOutput(x, "98765432109876543210"));
+
+    // bad input returns false and leaves zero, without throwing
+    const char* bad[] = { "", "-", "+1", " 1", "1 ", "12a4", "--1", "1-" };
+    for (size_t i = 0; i < 8; ++i) {
+        x = Int(77);
+        CHECK(!x.parse(bad[i], bad[i] + strlen(bad[i])));
+        CHECK(x.equals_int32(0));
+    }
+    CHECK(!x.parse(csv, csv + 4));  // includes the comma
+
+#if __cplusplus >= 201703L
+    std::string_view sv(csv);
+    CHECK(x.parse(sv.substr(19)) && testOutput(x, "98765432109876543210"));
+    CHECK(!x.parse(sv));
+#endif
+}
+
 } // namespace IntTest
@@ -21,7 +21,7 @@ int main() {
 //    std::cout << IntTest::runDivision(Int("152415787806666675432666675280250887626"),
 //                           Int("123456789123456789123456789"),
 //                           Int("1234567891234")) << std::endl;
-    UnitTest::RunAllTests();
+    return UnitTest::RunAllTests();
 
 //    std::cout << testOutput(Frac::from_double(0.123456789), "(123456789/1000000000)") << std::endl;
 }